@@ -0,0 +1,231 @@
+#include "GPS.h"
+#include <filesystem>
+
+namespace {
+struct ParsedTrack {
+    std::string file;
+    std::vector<TrackPoint> points;
+    std::unique_ptr<MappedTrack> mapped;
+    std::string error;
+};
+
+bool cacheIsFresh(const std::string& gpxFile, const std::string& cacheFile) {
+    std::error_code ec;
+    auto cacheTm = std::filesystem::last_write_time(cacheFile, ec);
+    if (ec) return false;
+    auto gpxTm = std::filesystem::last_write_time(gpxFile, ec);
+    return !ec && cacheTm >= gpxTm;
+}
+
+void loadTrack(ParsedTrack& track, bool useCache) {
+    if (!useCache) {
+        track.points = GPXParser::parse(track.file);
+        return;
+    }
+    std::string cacheFile = track.file + ".trk";
+    if (cacheIsFresh(track.file, cacheFile)) {
+        try {
+            track.mapped = std::make_unique<MappedTrack>(cacheFile);
+            return;
+        }
+        catch (std::exception&) {
+        }
+    }
+    track.points = GPXParser::parse(track.file);
+    try {
+        GPXParser::saveCache(track.points, cacheFile);
+    }
+    catch (std::exception&) {
+    }
+}
+
+TrackSummary failedTrack(std::string file, std::string error) {
+    TrackSummary summary;
+    summary.file = std::move(file);
+    summary.error = std::move(error);
+    return summary;
+}
+
+template<class Track>
+TrackSummary analyzeTrack(std::string file, const Track& track) {
+    TrackSummary summary;
+    summary.file = std::move(file);
+    summary.points = track.size();
+    try {
+        summary.timeDist = TimeDistAnalyzer(track).Analyze();
+        summary.ele = EleAnalyzer(track).Analyze();
+    }
+    catch (std::exception& a) {
+        summary.error = a.what();
+    }
+    return summary;
+}
+
+// Closes both queues and joins every worker when run() leaves, also through an
+// exception, so a failure in the consumer or while spawning cannot leave joinable
+// threads behind for std::terminate. Closing makes blocked pushes fail and lets
+// the pops drain, so every worker returns.
+class Workers final {
+public:
+    Workers(BoundedQueue<ParsedTrack>& p, BoundedQueue<TrackSummary>& a) : parsed(p), analyzed(a) {}
+    Workers(const Workers&) = delete;
+    Workers& operator=(const Workers&) = delete;
+    ~Workers() {
+        join();
+    }
+
+    template<class F>
+    void spawn(F f) {
+        threads.emplace_back(std::move(f));
+    }
+
+    void join() {
+        parsed.close();
+        analyzed.close();
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+private:
+    BoundedQueue<ParsedTrack>& parsed;
+    BoundedQueue<TrackSummary>& analyzed;
+    std::vector<std::thread> threads;
+};
+}
+
+BatchProcessor::BatchProcessor(size_t parsers, size_t analyzers, size_t queueCap)
+    : parserThreads(std::max<size_t>(parsers, 1)), analyzerThreads(std::max<size_t>(analyzers, 1)),
+    queueCapacity(queueCap) {}
+
+
+std::vector<std::string> BatchProcessor::collectInputs(const std::string& dirOrList) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    if (fs::is_directory(dirOrList)) {
+        for (const auto& entry : fs::recursive_directory_iterator(dirOrList)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".gpx") {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+    if (fs::path(dirOrList).extension() == ".gpx") {
+        files.push_back(dirOrList);
+        return files;
+    }
+    std::ifstream list(dirOrList);
+    if (!list.is_open()) {
+        throw std::runtime_error("error: dont open " + dirOrList);
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) files.push_back(line);
+    }
+    return files;
+}
+
+
+void BatchProcessor::setCache(bool on) {
+    useCache = on;
+}
+
+
+BatchStats BatchProcessor::run(const std::vector<std::string>& files, const std::string& reportFile, const std::string& summaryFile) const {
+    auto startTm = std::chrono::steady_clock::now();
+    // Both outputs are opened before any thread starts: a bad path has to throw
+    // here, not while unjoined threads would turn it into std::terminate.
+    std::ofstream report(reportFile);
+    if (!report.is_open()) {
+        throw std::runtime_error("error: dont open " + reportFile);
+    }
+    RecordWriter summaryOut(summaryFile, RecordWriter::formatFor(summaryFile).value_or(RecordWriter::Csv));
+    BoundedQueue<ParsedTrack> parsed(queueCapacity);
+    BoundedQueue<TrackSummary> analyzed(queueCapacity);
+    std::atomic<size_t> nextFile{ 0 };
+    // The last parser to finish closes parsed, the last analyzer closes analyzed.
+    std::atomic<size_t> parsersLeft{ parserThreads }, analyzersLeft{ analyzerThreads };
+    Workers workers(parsed, analyzed);
+
+    for (size_t i = 0; i < parserThreads; ++i) {
+        workers.spawn([&] {
+            for (size_t idx = nextFile++; idx < files.size(); idx = nextFile++) {
+                ParsedTrack track{ files[idx], {}, nullptr, {} };
+                try {
+                    loadTrack(track, useCache);
+                }
+                catch (std::exception& a) {
+                    track.points.clear();
+                    track.error = a.what();
+                }
+                if (!parsed.push(std::move(track))) break;
+            }
+            if (--parsersLeft == 0) parsed.close();
+        });
+    }
+    for (size_t i = 0; i < analyzerThreads; ++i) {
+        workers.spawn([&] {
+            while (auto track = parsed.pop()) {
+                if (!track->error.empty()) {
+                    analyzed.push(failedTrack(std::move(track->file), std::move(track->error)));
+                }
+                else if (track->mapped) {
+                    analyzed.push(analyzeTrack(std::move(track->file), *track->mapped));
+                }
+                else {
+                    analyzed.push(analyzeTrack(std::move(track->file), track->points));
+                }
+            }
+            if (--analyzersLeft == 0) analyzed.close();
+        });
+    }
+
+    BatchStats stats;
+    TimeDistAccumulator total;
+    EleAccumulator totalEle;
+    while (auto s = analyzed.pop()) {
+        ++stats.files;
+        stats.points += s->points;
+        if (!s->error.empty()) {
+            ++stats.failed;
+            summaryOut.write(s->file, s->points, {}, s->error);
+            continue;
+        }
+        const FinalAnalyzis& td = *s->timeDist;
+        const FinalAnalyzis& el = *s->ele;
+        summaryOut.write(s->file, s->points, { td, el });
+
+        total.totalDistance += *td.totalDistance;
+        total.totalTime += *td.totalTime;
+        total.movingTime += *td.movingTime;
+        total.maxSpeed = std::max(total.maxSpeed, *td.maxSpeed);
+        total.speedDistribution.merge(*td.speedDistribution);
+        EleAccumulator part;
+        part.minEle = *el.minEle;
+        part.maxEle = *el.maxEle;
+        part.elevationGain = *el.elevationGain;
+        part.elevationLoss = *el.elevationLoss;
+        totalEle.merge(part);
+    }
+    workers.join();
+    // Throws when any summary record failed to reach the file.
+    summaryOut.flush();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTm).count();
+
+    if (stats.failed < stats.files) {
+        AnalysisSaver::writeAnalysis(report, totalEle.result());
+        AnalysisSaver::writeAnalysis(report, total.result());
+    }
+    report << "files: " << stats.files << " (failed: " << stats.failed << ")\n"
+        << "points: " << stats.points << "\n"
+        << "seconds: " << stats.seconds << "\n"
+        << "files/s: " << stats.filesPerSecond() << "\n"
+        << "points/s: " << stats.pointsPerSecond() << "\n";
+    report.flush();
+    if (!report) {
+        throw std::runtime_error("error: cant write " + reportFile);
+    }
+    return stats;
+}
@@ -0,0 +1,227 @@
+#include "GPS.h"
+#include <random>
+
+namespace {
+    const double METERS_PER_DEGREE = 6371000.0 * M_PI / 180.0;
+
+    // 2024-01-01T00:00:00Z
+    const std::time_t SYNTHETIC_START = 1704067200;
+
+    void appendTime(std::string& buf, std::time_t t) {
+        using namespace std::chrono;
+        sys_seconds tp{ seconds(t) };
+        sys_days day = floor<days>(tp);
+        year_month_day ymd{ day };
+        hh_mm_ss<seconds> hms{ tp - day };
+        char tmp[32];
+        int parts[] = { static_cast<int>(ymd.year()), static_cast<int>(static_cast<unsigned>(ymd.month())),
+            static_cast<int>(static_cast<unsigned>(ymd.day())), static_cast<int>(hms.hours().count()),
+            static_cast<int>(hms.minutes().count()), static_cast<int>(hms.seconds().count()) };
+        const char seps[] = { '-', '-', 'T', ':', ':', 'Z' };
+        for (size_t i = 0; i < 6; ++i) {
+            char* p = tmp;
+            if (i > 0 && parts[i] < 10) *p++ = '0';
+            p = std::to_chars(p, tmp + sizeof(tmp), parts[i]).ptr;
+            *p++ = seps[i];
+            buf.append(tmp, p - tmp);
+        }
+    }
+
+    void appendNumber(std::string& buf, double v) {
+        char tmp[32];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::fixed, 7);
+        buf.append(tmp, res.ptr - tmp);
+    }
+
+    class Stage {
+    public:
+        Stage(std::ostream& o, const char* n, size_t cnt, const char* u = "Mpt/s")
+            : out(o), name(n), unit(u), count(cnt), start(std::chrono::steady_clock::now()) {}
+        ~Stage() {
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            out << std::left << std::setw(22) << name << std::right << std::setw(12) << count
+                << std::setw(12) << std::fixed << std::setprecision(4) << sec << " s"
+                << std::setw(12) << std::setprecision(2) << (sec > 0 ? count / sec / 1e6 : 0) << " " << unit << "\n"
+                << std::defaultfloat;
+        }
+    private:
+        std::ostream& out;
+        const char* name;
+        const char* unit;
+        size_t count;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Deletes the files of one benchmark size when it goes out of scope, even if a stage throws.
+    class ScratchFiles {
+    public:
+        explicit ScratchFiles(std::vector<std::string> f) : files(std::move(f)) {}
+        ScratchFiles(const ScratchFiles&) = delete;
+        ScratchFiles& operator=(const ScratchFiles&) = delete;
+        ~ScratchFiles() {
+            for (const std::string& f : files) std::remove(f.c_str());
+        }
+    private:
+        std::vector<std::string> files;
+    };
+}
+
+std::vector<TrackPoint> TrackGenerator::generate(const SyntheticTrackOptions& opt) {
+    std::mt19937_64 rng(opt.seed);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<TrackPoint> points;
+    points.reserve(opt.points);
+    double lat = 55.75, lon = 37.62, ele = 150;
+    double heading = uniform(rng) * 2 * M_PI, climb = 0;
+    double stopLeft = 0;
+    for (size_t i = 0; i < opt.points; ++i) {
+        double noiseLat = opt.noise * gauss(rng) / METERS_PER_DEGREE;
+        double noiseLon = opt.noise * gauss(rng) / (METERS_PER_DEGREE * cos(lat * M_PI / 180.0));
+        points.push_back({ lat + noiseLat, lon + noiseLon, ele + 0.5 * gauss(rng),
+            SYNTHETIC_START + static_cast<std::time_t>(std::llround(i * opt.interval)) });
+
+        if (stopLeft > 0) {
+            stopLeft -= opt.interval;
+            continue;
+        }
+        if (uniform(rng) < opt.stopRate) {
+            stopLeft = opt.stopDuration;
+            continue;
+        }
+        double step = std::max(opt.speed * (1 + 0.1 * gauss(rng)), 0.0) / 3.6 * opt.interval;
+        heading += 0.05 * gauss(rng);
+        lat += step * cos(heading) / METERS_PER_DEGREE;
+        lon += step * sin(heading) / (METERS_PER_DEGREE * cos(lat * M_PI / 180.0));
+        climb = 0.98 * climb + 0.002 * gauss(rng);
+        ele += climb * step;
+    }
+    return points;
+}
+
+void TrackGenerator::writeGpx(const std::vector<TrackPoint>& points, const std::string& filename, bool oneLine) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("error: cannot open " + filename);
+    }
+    std::string buf;
+    buf.reserve(1 << 20);
+    buf += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n"
+        "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" creator=\"TrackGenerator\" version=\"1.1\">\n"
+        "<trk>\n\t<name>synthetic</name>\n\t<trkseg>\n";
+    const char* sep = oneLine ? "" : "\n\t\t\t";
+    for (const TrackPoint& p : points) {
+        buf += "\t\t<trkpt lat=\"";
+        appendNumber(buf, p.lat);
+        buf += "\" lon=\"";
+        appendNumber(buf, p.lon);
+        buf += "\">";
+        buf += sep;
+        buf += "<time>";
+        appendTime(buf, p.time);
+        buf += "</time>";
+        buf += sep;
+        buf += "<ele>";
+        appendNumber(buf, p.ele);
+        buf += "</ele>";
+        buf += oneLine ? "" : "\n\t\t";
+        buf += "</trkpt>\n";
+        if (buf.size() > (1 << 20) - 256) {
+            out.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    buf += "\t</trkseg>\n</trk>\n</gpx>\n";
+    out.write(buf.data(), buf.size());
+}
+
+void benchmarkPipeline(std::ostream& out, const std::vector<size_t>& sizes, const std::string& workDir) {
+    ThreadPool pool;
+    for (size_t n : sizes) {
+        if (n < 2) continue;
+        const std::string gpx = workDir + "/bench_" + std::to_string(n) + ".gpx";
+        const std::string prefix = workDir + "/bench_" + std::to_string(n);
+        ScratchFiles scratch({ gpx, gpx + ".trk", prefix + ".txt", prefix + ".csv", prefix + ".jsonl", prefix + ".bin" });
+        out << "--- " << n << " points, " << pool.size() << " pool threads\n";
+
+        std::vector<TrackPoint> points;
+        {
+            Stage s(out, "generate", n);
+            SyntheticTrackOptions opt;
+            opt.points = n;
+            points = TrackGenerator::generate(opt);
+        }
+        {
+            Stage s(out, "write gpx", n);
+            TrackGenerator::writeGpx(points, gpx);
+        }
+        points.clear();
+        points.shrink_to_fit();
+        {
+            Stage s(out, "parse gpx", n);
+            points = GPXParser::parse(gpx);
+        }
+        {
+            Stage s(out, "write cache", n);
+            GPXParser::saveCache(points, gpx + ".trk");
+        }
+        size_t checksum = 0;
+        {
+            Stage s(out, "decode cache", n);
+            MappedTrack mapped(gpx + ".trk");
+            for (size_t i = 0; i < mapped.size(); ++i) checksum += mapped[i].time;
+        }
+        {
+            CompressedTrack compressed(points);
+            Stage s(out, "decode compressed", n);
+            CompressedTrack::Cursor c(compressed, 0);
+            for (size_t i = 0; i < compressed.size(); ++i) checksum += c.next().time;
+        }
+
+        EleAnalyzer ele(points);
+        TimeDistAnalyzer timeDist(points);
+        {
+            Stage s(out, "EleAnalyzer", n);
+            ele.Analyze();
+        }
+        {
+            Stage s(out, "TimeDistAnalyzer", n);
+            timeDist.Analyze();
+        }
+        ele.setThreadPool(&pool);
+        timeDist.setThreadPool(&pool);
+        {
+            Stage s(out, "EleAnalyzer pool", n);
+            ele.Analyze();
+        }
+        {
+            Stage s(out, "TimeDistAnalyzer pool", n);
+            timeDist.Analyze();
+        }
+
+        // Output is timed as one record per thousand points, as if the track
+        // were a batch of short ones.
+        AnalysisSaver saver;
+        saver.adddAnalyzer(&ele);
+        saver.adddAnalyzer(&timeDist);
+        const std::vector<FinalAnalyzis>& res = saver.results();
+        const size_t records = std::max<size_t>(n / 1000, 1);
+        {
+            Stage s(out, "save text", records, "Mrec/s");
+            std::ofstream text(prefix + ".txt");
+            for (size_t i = 0; i < records; ++i) {
+                for (const FinalAnalyzis& r : res) AnalysisSaver::writeAnalysis(text, r);
+            }
+        }
+        const std::pair<const char*, RecordWriter::Format> formats[] = {
+            { "save csv", RecordWriter::Csv }, { "save jsonl", RecordWriter::JsonLines }, { "save binary", RecordWriter::Binary } };
+        for (const auto& [name, format] : formats) {
+            Stage s(out, name, records, "Mrec/s");
+            RecordWriter writer(prefix + (format == RecordWriter::Csv ? ".csv" : format == RecordWriter::JsonLines ? ".jsonl" : ".bin"), format);
+            for (size_t i = 0; i < records; ++i) writer.write(gpx, n, res);
+            writer.flush();
+        }
+        if (checksum == 0) out << "(empty track)\n";
+    }
+}
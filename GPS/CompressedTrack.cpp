@@ -0,0 +1,83 @@
+#include "GPS.h"
+
+CompressedTrack::CompressedTrack(double coordSc, double eleSc) : coordScale(coordSc), eleScale(eleSc) {}
+
+CompressedTrack::CompressedTrack(const std::vector<TrackPoint>& points, double coordSc, double eleSc)
+    : coordScale(coordSc), eleScale(eleSc) {
+    blocks.reserve((points.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    bytes.reserve(points.size() * 5);
+    for (const TrackPoint& pt : points) {
+        append(pt);
+    }
+    shrinkToFit();
+}
+
+void CompressedTrack::writeDelta(int64_t delta) {
+    uint64_t v = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+    while (v >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(v));
+}
+
+void CompressedTrack::append(const TrackPoint& pt) {
+    int64_t lat = std::llround(pt.lat * coordScale);
+    int64_t lon = std::llround(pt.lon * coordScale);
+    int64_t ele = std::llround(pt.ele * eleScale);
+    int64_t time = static_cast<int64_t>(pt.time);
+    if (count % BLOCK_SIZE == 0) {
+        blocks.push_back({ bytes.size(), lat, lon, ele, time });
+    }
+    else {
+        writeDelta(lat - lastLat);
+        writeDelta(lon - lastLon);
+        writeDelta(ele - lastEle);
+        writeDelta(time - lastTime);
+    }
+    lastLat = lat;
+    lastLon = lon;
+    lastEle = ele;
+    lastTime = time;
+    ++count;
+}
+
+void CompressedTrack::shrinkToFit() {
+    blocks.shrink_to_fit();
+    bytes.shrink_to_fit();
+}
+
+size_t CompressedTrack::memoryBytes() const {
+    return sizeof(*this) + blocks.capacity() * sizeof(Block) + bytes.capacity();
+}
+
+TrackPoint CompressedTrack::operator[](size_t i) const {
+    if (i >= count) {
+        throw std::out_of_range("error: point index out of range");
+    }
+    return Cursor(*this, i).next();
+}
+
+void CompressedTrack::decodeBlock(size_t block, std::vector<TrackPoint>& out) const {
+    if (block >= blocks.size()) {
+        throw std::out_of_range("error: block index out of range");
+    }
+    size_t begin = block * BLOCK_SIZE;
+    size_t end = std::min(count, begin + BLOCK_SIZE);
+    out.clear();
+    Cursor cur(*this, begin);
+    for (size_t i = begin; i < end; ++i) {
+        out.push_back(cur.next());
+    }
+}
+
+std::vector<TrackPoint> CompressedTrack::toPoints() const {
+    std::vector<TrackPoint> points;
+    points.reserve(count);
+    if (count == 0) return points;
+    Cursor cur(*this, 0);
+    for (size_t i = 0; i < count; ++i) {
+        points.push_back(cur.next());
+    }
+    return points;
+}
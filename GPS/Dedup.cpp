@@ -0,0 +1,204 @@
+#include "GPS.h"
+
+namespace {
+    uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+}
+
+MinHasher::MinHasher(size_t hashes, unsigned geohashPrecision, size_t shingleLen, uint64_t seed)
+    : precision(geohashPrecision), shingleLength(shingleLen) {
+    if (hashes == 0 || shingleLength == 0 || precision == 0 || precision > 12) {
+        throw std::runtime_error("error: invalid MinHash parameters");
+    }
+    seeds.reserve(hashes);
+    for (size_t i = 0; i < hashes; ++i) {
+        seed = mix(seed);
+        seeds.push_back(seed);
+    }
+}
+
+uint64_t MinHasher::geohash(double lat, double lon, unsigned precision) {
+    const unsigned bits = 5 * precision;
+    const unsigned lonBits = (bits + 1) / 2, latBits = bits / 2;
+    auto quantize = [](double v, double lo, double hi, unsigned n) {
+        double cells = std::ldexp(1.0, n);
+        double q = std::floor((v - lo) / (hi - lo) * cells);
+        return static_cast<uint64_t>(std::clamp(q, 0.0, cells - 1));
+    };
+    uint64_t x = quantize(lon, -180, 180, lonBits);
+    uint64_t y = quantize(lat, -90, 90, latBits);
+    uint64_t code = 0;
+    for (unsigned i = 0; i < bits; ++i) {
+        // Even bits (from the top) are longitude.
+        uint64_t bit = i % 2 == 0 ? (x >> (lonBits - 1 - i / 2)) & 1 : (y >> (latBits - 1 - i / 2)) & 1;
+        code = (code << 1) | bit;
+    }
+    return code;
+}
+
+std::vector<uint64_t> MinHasher::shingles(const std::vector<TrackPoint>& points) const {
+    std::vector<uint64_t> cells;
+    for (const TrackPoint& p : points) {
+        uint64_t cell = geohash(p.lat, p.lon, precision);
+        if (cells.empty() || cells.back() != cell) cells.push_back(cell);
+    }
+    std::vector<uint64_t> res;
+    if (cells.empty()) return res;
+    const size_t k = std::min(shingleLength, cells.size());
+    res.reserve(cells.size() - k + 1);
+    for (size_t i = 0; i + k <= cells.size(); ++i) {
+        uint64_t h = 0;
+        for (size_t j = 0; j < k; ++j) h = mix(h ^ cells[i + j]);
+        res.push_back(h);
+    }
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+TrackFingerprint MinHasher::fingerprint(const std::vector<TrackPoint>& points) const {
+    TrackFingerprint fp;
+    std::vector<uint64_t> sh = shingles(points);
+    fp.shingles = sh.size();
+    fp.signature.assign(seeds.size(), UINT32_MAX);
+    for (uint64_t s : sh) {
+        for (size_t i = 0; i < seeds.size(); ++i) {
+            uint32_t h = static_cast<uint32_t>(mix(s ^ seeds[i]) >> 32);
+            if (h < fp.signature[i]) fp.signature[i] = h;
+        }
+    }
+    return fp;
+}
+
+
+LshIndex::LshIndex(size_t b, size_t r) : bands(b), rows(r) {
+    if (bands == 0 || rows == 0) {
+        throw std::runtime_error("error: invalid LSH parameters");
+    }
+}
+
+uint64_t LshIndex::bandKey(const TrackFingerprint& fp, size_t band) const {
+    uint64_t h = mix(band);
+    for (size_t i = band * rows; i < (band + 1) * rows; ++i) h = mix(h ^ fp.signature[i]);
+    return h;
+}
+
+size_t LshIndex::partitionOf(size_t shingles) {
+    // [2^p, 2^(p+1)) shingles
+    size_t p = 0;
+    while (shingles >>= 1) ++p;
+    return p;
+}
+
+uint64_t LshIndex::prefixKey(const TrackFingerprint& fp, size_t partition, size_t band, size_t prefix) const {
+    uint64_t h = mix((static_cast<uint64_t>(partition) << 48) ^ (static_cast<uint64_t>(prefix) << 32) ^ band);
+    for (size_t i = band * rows; i < band * rows + prefix; ++i) h = mix(h ^ fp.signature[i]);
+    return h;
+}
+
+size_t LshIndex::prefixFor(double s) const {
+    for (size_t r = rows; r > 1; --r) {
+        if (1 - std::pow(1 - std::pow(s, static_cast<double>(r)), static_cast<double>(bands)) >= 0.9) return r;
+    }
+    return 1;
+}
+
+uint32_t LshIndex::add(TrackFingerprint fp) {
+    if (fp.signature.size() != bands * rows) {
+        throw std::runtime_error("error: signature size does not match the LSH bands");
+    }
+    uint32_t id = static_cast<uint32_t>(tracks.size());
+    // Tracks without shingles would all share the empty signature.
+    if (fp.shingles > 0) {
+        size_t partition = partitionOf(fp.shingles);
+        partitions |= 1ull << partition;
+        for (size_t band = 0; band < bands; ++band) {
+            buckets[bandKey(fp, band)].push_back(id);
+            for (size_t prefix = 1; prefix <= rows; ++prefix) {
+                prefixBuckets[prefixKey(fp, partition, band, prefix)].push_back(id);
+            }
+        }
+    }
+    tracks.push_back(std::move(fp));
+    return id;
+}
+
+void LshIndex::containmentCandidates(const TrackFingerprint& fp, double minContainment, size_t firstPartition, std::vector<uint32_t>& out) const {
+    const double q = static_cast<double>(fp.shingles), t = minContainment;
+    for (size_t partition = firstPartition; partition < 64; ++partition) {
+        if (!(partitions >> partition & 1)) continue;
+        // Lowest Jaccard of a pair with containment t over the partition's sizes:
+        // a smaller track at the lower bound or a larger one at the upper bound.
+        double lo = std::ldexp(1.0, static_cast<int>(partition)), hi = 2 * lo - 1;
+        double s = 1;
+        if (lo < q) s = std::min(s, t * lo / (q + lo - t * lo));
+        if (hi >= q) s = std::min(s, t * q / (q + hi - t * q));
+        size_t prefix = prefixFor(s);
+        for (size_t band = 0; band < bands; ++band) {
+            auto it = prefixBuckets.find(prefixKey(fp, partition, band, prefix));
+            if (it != prefixBuckets.end()) out.insert(out.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
+
+std::vector<uint32_t> LshIndex::candidates(const TrackFingerprint& fp, double minContainment) const {
+    std::vector<uint32_t> res;
+    if (fp.shingles == 0 || fp.signature.size() != bands * rows) return res;
+    for (size_t band = 0; band < bands; ++band) {
+        auto it = buckets.find(bandKey(fp, band));
+        if (it != buckets.end()) res.insert(res.end(), it->second.begin(), it->second.end());
+    }
+    containmentCandidates(fp, minContainment, 0, res);
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+double LshIndex::jaccard(const TrackFingerprint& a, const TrackFingerprint& b) {
+    size_t n = std::min(a.signature.size(), b.signature.size()), same = 0;
+    for (size_t i = 0; i < n; ++i) same += a.signature[i] == b.signature[i];
+    return n ? static_cast<double>(same) / n : 0.0;
+}
+
+TrackMatch LshIndex::compare(uint32_t ia, const TrackFingerprint& a, uint32_t ib, const TrackFingerprint& b) {
+    double j = jaccard(a, b);
+    // |A n B| = J / (1 + J) * (|A| + |B|)
+    double shared = j / (1 + j) * static_cast<double>(a.shingles + b.shingles);
+    size_t smaller = std::min(a.shingles, b.shingles);
+    double containment = smaller ? std::min(shared / smaller, 1.0) : 0.0;
+    return { ia, ib, j, containment };
+}
+
+std::vector<TrackMatch> LshIndex::findSimilar(double minJaccard, double minContainment) const {
+    std::unordered_set<uint64_t> seen;
+    std::vector<TrackMatch> res;
+    auto check = [&](uint32_t a, uint32_t b) {
+        if (a > b) std::swap(a, b);
+        uint64_t pair = (static_cast<uint64_t>(a) << 32) | b;
+        if (a == b || !seen.insert(pair).second) return;
+        TrackMatch m = compare(a, tracks[a], b, tracks[b]);
+        if (m.jaccard >= minJaccard || m.containment >= minContainment) res.push_back(m);
+    };
+    for (const auto& [key, ids] : buckets) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            for (size_t j = i + 1; j < ids.size(); ++j) check(ids[i], ids[j]);
+        }
+    }
+    // Every pair is reached from its smaller track, so only partitions at or
+    // above the query's own are searched.
+    std::vector<uint32_t> found;
+    for (uint32_t id = 0; id < tracks.size(); ++id) {
+        if (tracks[id].shingles == 0) continue;
+        found.clear();
+        containmentCandidates(tracks[id], minContainment, partitionOf(tracks[id].shingles), found);
+        for (uint32_t other : found) check(id, other);
+    }
+    std::sort(res.begin(), res.end(), [](const TrackMatch& x, const TrackMatch& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    return res;
+}
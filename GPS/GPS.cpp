@@ -52,9 +52,51 @@ std::time_t GPXParser::parseTime(const std::string& timestr) {
 
 
 
+SpeedHistogram::SpeedHistogram(int binWidth): width(std::max(binWidth, 1)) {}
+
+void SpeedHistogram::merge(const SpeedHistogram& other) {
+    if (other.width != width) {
+        throw std::runtime_error("error: histogram bin width mismatch");
+    }
+    if (other.bins.size() > bins.size()) bins.resize(other.bins.size(), 0.0);
+    for (size_t i = 0; i < other.bins.size(); ++i) {
+        bins[i] += other.bins[i];
+    }
+}
+
+double SpeedHistogram::totalTime() const {
+    double total = 0;
+    for (double t : bins) total += t;
+    return total;
+}
+
+double SpeedHistogram::percentile(double p) const {
+    double total = totalTime();
+    if (total <= 0) return 0;
+    double target = std::clamp(p, 0.0, 1.0) * total;
+    double cum = 0;
+    for (size_t i = 0; i < bins.size(); ++i) {
+        if (bins[i] > 0 && cum + bins[i] >= target) {
+            return binStart(i) + width * (target - cum) / bins[i];
+        }
+        cum += bins[i];
+    }
+    return binStart(bins.size());
+}
+
+bool SpeedHistogram::operator==(const SpeedHistogram& other) const {
+    if (width != other.width) return false;
+    for (size_t i = 0; i < std::max(bins.size(), other.bins.size()); ++i) {
+        if ((*this)[i] != other[i]) return false;
+    }
+    return true;
+}
+
+
+
 FinalAnalyzis::FinalAnalyzis(std::optional<double> totalDist, std::optional<double> totalTm, 
     std::optional<double> movingTm, std::optional<double> maxSpd, std::optional<double> avgSpd,
-    std::optional<double> avgMovingSpd, const std::optional<std::unordered_map<int, double >>& speedDistr, 
+    std::optional<double> avgMovingSpd, const std::optional<SpeedHistogram>& speedDistr, 
     std::optional<double> mele, std::optional<double> maxele, std::optional<double> elegain, std::optional<double> eleloss) {
         totalDistance = totalDist;
         totalTime = totalTm;
@@ -71,85 +113,116 @@ FinalAnalyzis::FinalAnalyzis(std::optional<double> totalDist, std::optional<doub
 
 
 
-TrackAnalyzer::TrackAnalyzer(const std::vector<TrackPoint>& pts): points(pts) {}
+TimeDistAccumulator::TimeDistAccumulator(double stopSpd, int spdBin): stopSpeed(stopSpd), speedDistribution(spdBin) {}
 
+void TimeDistAccumulator::add(double dist, double dt) {
+    if (segmenter) segmenter->add(dist, dt);
+    if (dt <= 0) return;
+    totalDistance += dist;
+    totalTime += dt;
+    double speed = dist / (dt / 3600.0); // km/h
+    speedDistribution.add(speed, dt);
+    if (speed > stopSpeed) {
+        movingTime += dt;
+        if (speed > maxSpeed) maxSpeed = speed;
+    }
+}
 
-double TrackAnalyzer::deg2rad(double deg) { return deg * M_PI / 180.0; }
+void TimeDistAccumulator::merge(const TimeDistAccumulator& other) {
+    totalDistance += other.totalDistance;
+    totalTime += other.totalTime;
+    movingTime += other.movingTime;
+    maxSpeed = std::max(maxSpeed, other.maxSpeed);
+    speedDistribution.merge(other.speedDistribution);
+}
 
-double TrackAnalyzer::haversine(const TrackPoint& a, const TrackPoint& b) {
-        static const double R = 6371.0;
-        double dLat = deg2rad(b.lat - a.lat);
-        double dLon = deg2rad(b.lon - a.lon);
-        double lat1 = deg2rad(a.lat);
-        double lat2 = deg2rad(b.lat);
-        double h = pow(sin(dLat / 2), 2) + cos(lat1) * cos(lat2) * pow(sin(dLon / 2), 2);
-        return 2 * R * asin(sqrt(h));
-    }
+FinalAnalyzis TimeDistAccumulator::result() const {
+    double avgSpeed = totalDistance / (totalTime / 3600.0);
+    double avgMovingSpeed = totalDistance / (movingTime / 3600.0);
+    FinalAnalyzis res(totalDistance, totalTime, movingTime, maxSpeed, avgSpeed, avgMovingSpeed, speedDistribution, std::nullopt, std::nullopt, std::nullopt, std::nullopt);
+    if (segmenter) res.motionIntervals = segmenter->intervals();
+    return res;
+}
 
 
-EleAnalyzer::EleAnalyzer(const std::vector<TrackPoint>& pts): TrackAnalyzer(pts){}
+void EleAccumulator::add(double prevEle, double ele) {
+    if (ele > maxEle) maxEle = ele;
+    if (ele < minEle) minEle = ele;
+    double deltaEle = ele - prevEle;
+    if (deltaEle > 0) elevationGain += deltaEle;
+    else elevationLoss -= deltaEle;
+}
 
-FinalAnalyzis EleAnalyzer::Analyze(double stopSpeed, int speedBin){
-        double minEle = 0;
-        double maxEle = 0;
-        double elevationGain = 0;
-        double elevationLoss = 0;
-        if (points.size() < 2) {
-            throw std::runtime_error("error: Wrong type");
-        }
-        double prevEle = points[0].ele;
-        double prevLat = points[0].lat, prevLon = points[0].lon;
-        for (size_t i = 1; i < points.size(); ++i) {
-            if (points[i].ele > maxEle) maxEle = points[i].ele;
-            if (points[i].ele < minEle) minEle = points[i].ele;
-            double deltaEle = points[i].ele - prevEle;
-            if (deltaEle > 0) elevationGain += deltaEle;
-            else elevationLoss -= deltaEle;
-            prevEle = points[i].ele;
-        }
-        
-        return (FinalAnalyzis(std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, minEle, maxEle, elevationGain, elevationLoss));
-    }
+void EleAccumulator::merge(const EleAccumulator& other) {
+    minEle = std::min(minEle, other.minEle);
+    maxEle = std::max(maxEle, other.maxEle);
+    elevationGain += other.elevationGain;
+    elevationLoss += other.elevationLoss;
+}
+
+FinalAnalyzis EleAccumulator::result() const {
+    return (FinalAnalyzis(std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, minEle, maxEle, elevationGain, elevationLoss));
+}
 
 
 
+TrackAnalyzer::TrackAnalyzer(const std::vector<TrackPoint>& pts): source(&pts) {}
+TrackAnalyzer::TrackAnalyzer(const MappedTrack& track): source(&track) {}
+TrackAnalyzer::TrackAnalyzer(const CompressedTrack& track): source(&track) {}
 
- TimeDistAnalyzer::TimeDistAnalyzer(const std::vector<TrackPoint>& pts): TrackAnalyzer(pts){
+size_t TrackAnalyzer::pointCount() const {
+    return std::visit([](const auto* track) { return track->size(); }, source);
+}
+
+void TrackAnalyzer::setThreadPool(ThreadPool* pl, size_t chunk) {
+    pool = pl;
+    chunkSize = std::max<size_t>(chunk, 1);
+}
+
+
+double TrackAnalyzer::deg2rad(double deg) { return deg * M_PI / 180.0; }
+
+double TrackAnalyzer::haversine(const TrackPoint& a, const TrackPoint& b) {
+        return HaversineMetric::distance(a, b);
     }
 
- FinalAnalyzis TimeDistAnalyzer::Analyze(double stopSpeed, int speedBin){
-        double totalDistance = 0;
-        double totalTime = 0;
-        double movingTime = 0;
-        double maxSpeed = 0; 
-        double avgSpeed = 0; 
-        double avgMovingSpeed = 0;
-        std::unordered_map<int, double> speedDistribution;
-        if (points.size() < 2) {
+
+EleAnalyzer::EleAnalyzer(const std::vector<TrackPoint>& pts): TrackAnalyzer(pts){}
+EleAnalyzer::EleAnalyzer(const MappedTrack& track): TrackAnalyzer(track){}
+EleAnalyzer::EleAnalyzer(const CompressedTrack& track): TrackAnalyzer(track){}
+
+void EleAnalyzer::setFilter(std::optional<ElevationFilter> f) {
+    filter = std::move(f);
+}
+
+FinalAnalyzis EleAnalyzer::Analyze(double stopSpeed, int speedBin){
+        if (pointCount() < 2) {
             throw std::runtime_error("error: Wrong type");
         }
-        std::time_t prevTime = points[0].time;
-        double prevLat = points[0].lat, prevLon = points[0].lon;
-        bool moving = false;
-        double segmentDist = 0;
-        std::time_t segmentTime = 0;
-        for (size_t i = 1; i < points.size(); ++i) {
-            double dist = haversine(points[i - 1], points[i]);
-            double dt = difftime(points[i].time, points[i - 1].time);
-            if (dt <= 0) continue;
-            totalDistance += dist;
-            totalTime += dt;
-            double speed = dist / (dt / 3600.0); // km/h
-            speedDistribution[int(speed) / speedBin * speedBin] += dt;
-            if (speed > stopSpeed) {
-                movingTime += dt;
-                if (speed > maxSpeed) maxSpeed = speed;
-            }
+        if (!filter) {
+            EleAccumulator acc = reduceChunks(EleAccumulator(), [](EleAccumulator& part, const auto& track, size_t begin, size_t end) {
+                forEachSegment(track, begin, end, [&part](const TrackPoint& a, const TrackPoint& b) {
+                    part.add(a.ele, b.ele);
+                });
+            });
+            return acc.result();
         }
-        avgSpeed = totalDistance / (totalTime / 3600.0);
-        avgMovingSpeed = totalDistance / (movingTime / 3600.0);
-
-        return(FinalAnalyzis(totalDistance, totalTime, movingTime, maxSpeed, avgSpeed, avgMovingSpeed, speedDistribution, std::nullopt, std::nullopt, std::nullopt, std::nullopt));
+        // A windowed filter is warmed up on the points before the chunk, which
+        // reproduces the state the sequential pass would have there.
+        const size_t memory = filter->memory();
+        EleAccumulator acc = reduceChunks(EleAccumulator(), [this, memory](EleAccumulator& part, const auto& track, size_t begin, size_t end) {
+            ElevationFilter f = *filter;
+            f.reset();
+            size_t from = memory > 0 && begin > memory ? begin - memory : 0;
+            double prev = f.push(track[from].ele);
+            forEachSegment(track, from + 1, begin, [&f, &prev](const TrackPoint&, const TrackPoint& b) { prev = f.push(b.ele); });
+            forEachSegment(track, begin, end, [&part, &f, &prev](const TrackPoint&, const TrackPoint& b) {
+                double cur = f.push(b.ele);
+                part.add(prev, cur);
+                prev = cur;
+            });
+        }, memory > 0);
+        return acc.result();
     }
 
 
@@ -161,8 +234,14 @@ FinalAnalyzis EleAnalyzer::Analyze(double stopSpeed, int speedBin){
  void AnalysisSaver::saveAnalysis(const std::string& outFile) {
      std::ofstream out(outFile);
 
-     for (TrackAnalyzer* a : Analyzers) {
-         FinalAnalyzis analyzer = a->Analyze();
+     for (const FinalAnalyzis& r : results()) {
+         writeAnalysis(out, r);
+     }
+
+        out.close();
+    }
+
+ void AnalysisSaver::writeAnalysis(std::ostream& out, const FinalAnalyzis& analyzer) {
          if (analyzer.minEle) {
              out << " : " << *analyzer.minEle << "\n";
          }
@@ -209,15 +288,14 @@ FinalAnalyzis EleAnalyzer::Analyze(double stopSpeed, int speedBin){
 
          if (analyzer.speedDistribution) {
              out << " :\n";
-             for (const auto& kv : *analyzer.speedDistribution) {
-                 out << kv.first << "-" << kv.first + 5 - 1 << ", "
-                     << kv.second << "\n";
+             const SpeedHistogram& hist = *analyzer.speedDistribution;
+             for (size_t bin = 0; bin < hist.binCount(); ++bin) {
+                 if (hist[bin] > 0) {
+                     out << hist.binStart(bin) << "-" << hist.binStart(bin) + hist.binWidth() - 1 << ", "
+                         << hist[bin] << "\n";
+                 }
              }
          }          
-          
-     }
-          
-        out.close();
     }
 
 
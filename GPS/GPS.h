@@ -1,3 +1,4 @@
+#pragma once
 #define _USE_MATH_DEFINES
 #include <iostream>
 #include <fstream>
@@ -10,17 +11,86 @@
 #include <map>
 #include <optional>
 #include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <queue>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <variant>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <charconv>
+#include <string_view>
+#include <unordered_set>
+#include "Geo.h"
 
 
-struct TrackPoint {
-    double lat, lon, ele;
-    std::time_t time;
+// Flat-earth approximation around the segment midpoint: one cos and one sqrt,
+// good to well under 0.1% on segments of a few kilometres.
+struct EquirectangularMetric {
+    static double distance(const TrackPoint& a, const TrackPoint& b) {
+        static const double R = 6371.0;
+        const double toRad = M_PI / 180.0;
+        double dLon = b.lon - a.lon;
+        // the short way round across the antimeridian
+        if (dLon > 180) dLon -= 360;
+        else if (dLon < -180) dLon += 360;
+        double x = dLon * toRad * cos((a.lat + b.lat) * 0.5 * toRad);
+        double y = (b.lat - a.lat) * toRad;
+        return R * sqrt(x * x + y * y);
+    }
+};
+
+// Vincenty inverse formula on the WGS-84 ellipsoid, sub-millimetre; falls back to
+// haversine for the nearly antipodal points where the iteration does not converge.
+struct VincentyMetric {
+    static double distance(const TrackPoint& p1, const TrackPoint& p2) {
+        const double a = 6378137.0, f = 1 / 298.257223563, b = (1 - f) * a;
+        const double toRad = M_PI / 180.0;
+        double L = (p2.lon - p1.lon) * toRad;
+        double U1 = atan((1 - f) * tan(p1.lat * toRad));
+        double U2 = atan((1 - f) * tan(p2.lat * toRad));
+        double sinU1 = sin(U1), cosU1 = cos(U1), sinU2 = sin(U2), cosU2 = cos(U2);
+        double lambda = L, sinSigma = 0, cosSigma = 0, sigma = 0, cos2Alpha = 0, cos2SigmaM = 0;
+        for (int iter = 0; iter < 100; ++iter) {
+            double sinLambda = sin(lambda), cosLambda = cos(lambda);
+            double t = cosU1 * sinU2 - sinU1 * cosU2 * cosLambda;
+            sinSigma = sqrt(cosU2 * sinLambda * cosU2 * sinLambda + t * t);
+            if (sinSigma == 0) return 0;
+            cosSigma = sinU1 * sinU2 + cosU1 * cosU2 * cosLambda;
+            sigma = atan2(sinSigma, cosSigma);
+            double sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma;
+            cos2Alpha = 1 - sinAlpha * sinAlpha;
+            cos2SigmaM = cos2Alpha != 0 ? cosSigma - 2 * sinU1 * sinU2 / cos2Alpha : 0;
+            double C = f / 16 * cos2Alpha * (4 + f * (4 - 3 * cos2Alpha));
+            double prev = lambda;
+            lambda = L + (1 - C) * f * sinAlpha
+                * (sigma + C * sinSigma * (cos2SigmaM + C * cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)));
+            if (std::abs(lambda - prev) < 1e-12) {
+                double u2 = cos2Alpha * (a * a - b * b) / (b * b);
+                double A = 1 + u2 / 16384 * (4096 + u2 * (-768 + u2 * (320 - 175 * u2)));
+                double B = u2 / 1024 * (256 + u2 * (-128 + u2 * (74 - 47 * u2)));
+                double dSigma = B * sinSigma * (cos2SigmaM + B / 4 * (cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)
+                    - B / 6 * cos2SigmaM * (-3 + 4 * sinSigma * sinSigma) * (-3 + 4 * cos2SigmaM * cos2SigmaM)));
+                return b * A * (sigma - dSigma) / 1000.0;
+            }
+        }
+        return HaversineMetric::distance(p1, p2);
+    }
 };
 
 class GPXParser {
 public:
     GPXParser() = delete;
     static std::vector<TrackPoint> parse(const std::string& filename);
+    // Writes the binary columnar cache read back by MappedTrack.
+    static void saveCache(const std::vector<TrackPoint>& points, const std::string& filename);
 private:
     static double takeDouble(const std::string& line, const std::string& attr);
     static double takeTagDouble(const std::string& line, const std::string& tag);
@@ -28,59 +98,870 @@ private:
     static std::time_t parseTime(const std::string& timestr);
 };
 
+// Cache file layout: this header, then the lat, lon, ele (double) and time
+// (int64) columns at 8-byte aligned offsets from the start of the file.
+struct TrackCacheHeader {
+    enum Column { Lat, Lon, Ele, Time, ColumnCount };
+    static constexpr uint32_t MAGIC = 0x54535047; // "GPST"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint64_t count = 0;
+    uint64_t offset[ColumnCount] = {};
+    double minValue[ColumnCount] = {};
+    double maxValue[ColumnCount] = {};
+};
+
+// Read-only memory mapping of a track cache; the columns point straight into the file.
+class MappedTrack final {
+public:
+    explicit MappedTrack(const std::string& filename);
+    ~MappedTrack();
+    MappedTrack(const MappedTrack&) = delete;
+    MappedTrack& operator=(const MappedTrack&) = delete;
+
+    size_t size() const { return count; }
+    const TrackCacheHeader& header() const { return *reinterpret_cast<const TrackCacheHeader*>(data); }
+    TrackPoint operator[](size_t i) const { return { lat[i], lon[i], ele[i], static_cast<std::time_t>(time[i]) }; }
+    std::vector<TrackPoint> toPoints() const;
+
+private:
+    void unmap();
+
+    const char* data = nullptr;
+    size_t bytes = 0;
+    size_t count = 0;
+    const double* lat = nullptr;
+    const double* lon = nullptr;
+    const double* ele = nullptr;
+    const int64_t* time = nullptr;
+};
+
+// Calls fn(track[i - 1], track[i]) for i in [begin, end).
+template<class Track, class F>
+void forEachSegment(const Track& track, size_t begin, size_t end, F&& fn) {
+    for (size_t i = begin; i < end; ++i) {
+        fn(track[i - 1], track[i]);
+    }
+}
+
+// Resident track storage at a few bytes per point. Coordinates and elevation are kept
+// as fixed point (by default 1e-6 degree, the precision GPX files carry, and decimetres)
+// and time as whole seconds. Every BLOCK_SIZE points a block starts with absolute
+// values, the rest are zigzag varint deltas to the previous point.
+class CompressedTrack final {
+public:
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    explicit CompressedTrack(double coordScale = 1e6, double eleScale = 10);
+    explicit CompressedTrack(const std::vector<TrackPoint>& points, double coordScale = 1e6, double eleScale = 10);
+
+    void append(const TrackPoint& pt);
+    void shrinkToFit();
+
+    size_t size() const { return count; }
+    size_t blockCount() const { return blocks.size(); }
+    size_t memoryBytes() const;
+
+    // Random access decodes from the start of the block holding i.
+    TrackPoint operator[](size_t i) const;
+    void decodeBlock(size_t block, std::vector<TrackPoint>& out) const;
+    std::vector<TrackPoint> toPoints() const;
+
+    // Sequential decoder starting at point i.
+    class Cursor {
+    public:
+        Cursor(const CompressedTrack& tr, size_t i) : track(tr), index(i - i % BLOCK_SIZE) {
+            for (size_t skip = i % BLOCK_SIZE + 1; skip > 0; --skip) {
+                step();
+            }
+        }
+        TrackPoint next() {
+            TrackPoint pt = current();
+            step();
+            return pt;
+        }
+
+    private:
+        TrackPoint current() const {
+            return { lat / track.coordScale, lon / track.coordScale, ele / track.eleScale, static_cast<std::time_t>(time) };
+        }
+        void step() {
+            if (index >= track.count) return;
+            if (index % BLOCK_SIZE == 0) {
+                const Block& b = track.blocks[index / BLOCK_SIZE];
+                pos = track.bytes.data() + b.offset;
+                lat = b.lat; lon = b.lon; ele = b.ele; time = b.time;
+            }
+            else {
+                lat += readDelta(); lon += readDelta(); ele += readDelta(); time += readDelta();
+            }
+            ++index;
+        }
+        int64_t readDelta() {
+            uint64_t v = 0;
+            for (int shift = 0;; shift += 7) {
+                uint8_t byte = *pos++;
+                v |= uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+        }
+
+        const CompressedTrack& track;
+        size_t index;
+        const uint8_t* pos = nullptr;
+        int64_t lat = 0, lon = 0, ele = 0, time = 0;
+    };
+
+private:
+    struct Block {
+        uint64_t offset;
+        int64_t lat, lon, ele, time;
+    };
+    void writeDelta(int64_t delta);
+
+    double coordScale, eleScale;
+    std::vector<Block> blocks;
+    std::vector<uint8_t> bytes;
+    size_t count = 0;
+    int64_t lastLat = 0, lastLon = 0, lastEle = 0, lastTime = 0;
+};
+
+template<class F>
+void forEachSegment(const CompressedTrack& track, size_t begin, size_t end, F&& fn) {
+    if (begin >= end) return;
+    CompressedTrack::Cursor cur(track, begin - 1);
+    TrackPoint prev = cur.next();
+    for (size_t i = begin; i < end; ++i) {
+        TrackPoint pt = cur.next();
+        fn(prev, pt);
+        prev = pt;
+    }
+}
+
+// Time spent in fixed-width speed bins [k * width, (k + 1) * width), stored densely
+// so add() is an index and histograms from different chunks or tracks merge bin by bin.
+class SpeedHistogram final {
+public:
+    // Speeds beyond the last bin are counted in it, so a GPS glitch cannot blow up the array.
+    static constexpr size_t MAX_BINS = 4096;
+
+    explicit SpeedHistogram(int binWidth = 5);
+
+    void add(double speed, double dt) {
+        size_t bin = std::min(static_cast<size_t>(int(speed) / width), MAX_BINS - 1);
+        if (bin >= bins.size()) bins.resize(bin + 1, 0.0);
+        bins[bin] += dt;
+    }
+    void merge(const SpeedHistogram& other);
+
+    int binWidth() const { return width; }
+    size_t binCount() const { return bins.size(); }
+    int binStart(size_t bin) const { return static_cast<int>(bin) * width; }
+    double operator[](size_t bin) const { return bin < bins.size() ? bins[bin] : 0.0; }
+    double totalTime() const;
+
+    // Speed under which the fraction p (0..1) of the time was spent, interpolated inside its bin;
+    // 0 when no time was recorded.
+    double percentile(double p) const;
+
+    bool operator==(const SpeedHistogram& other) const;
+
+private:
+    int width;
+    std::vector<double> bins;
+};
+
+// Run of points [begin, end] that were all moving or all stopped; neighbouring
+// intervals share their boundary point.
+struct MotionInterval {
+    size_t begin, end;
+    double duration, distance;
+    bool moving;
+};
+
+// Stop/move segmentation fed one segment at a time. A stop starts when the speed
+// drops to stopSpeed and ends only once it exceeds moveSpeed; stops shorter than
+// minStopDuration seconds are folded into the surrounding movement. Memory is
+// proportional to the number of intervals.
+class StopMoveSegmenter final {
+public:
+    StopMoveSegmenter(double stopSpd = 1.0, double moveSpd = 3.0, double minStop = 60);
+
+    // Segment between points (n - 1, n) for the n-th call.
+    void add(double dist, double dt);
+    // Closed intervals plus the open one, as if the track ended now.
+    std::vector<MotionInterval> intervals() const;
+
+private:
+    enum class State { Moving, CandidateStop, Stopped };
+    static void extend(MotionInterval& iv, size_t index, double dist, double dt);
+    // Candidate becomes a stop once it lasts minStopDuration.
+    void confirmStop();
+
+    double stopSpeed, moveSpeed, minStopDuration;
+    State state = State::Moving;
+    size_t next = 1;
+    MotionInterval moving{ 0, 0, 0, 0, true };
+    MotionInterval stop{ 0, 0, 0, 0, false };
+    std::vector<MotionInterval> closed;
+};
+
 struct FinalAnalyzis {
     FinalAnalyzis(std::optional<double> totalDist, std::optional<double> totalTm,
         std::optional<double> movingTm, std::optional<double> maxSpd, std::optional<double> avgSpd,
-        std::optional<double> avgMovingSpd, const std::optional<std::unordered_map<int, double >>& speedDistr,
-        std::optional<double> mele, std::optional<double> maxele, std::optional<double> elegain, std::optional<double> eleloss);//const, unordered_map
+        std::optional<double> avgMovingSpd, const std::optional<SpeedHistogram>& speedDistr,
+        std::optional<double> mele, std::optional<double> maxele, std::optional<double> elegain, std::optional<double> eleloss);
 
 
     std::optional<double> minEle, maxEle, elevationGain, elevationLoss;
     std::optional<double> totalDistance, totalTime, movingTime, maxSpeed, avgSpeed, avgMovingSpeed;
-    std::optional<std::unordered_map<int, double>> speedDistribution;
+    std::optional<SpeedHistogram> speedDistribution;
+    std::optional<std::vector<MotionInterval>> motionIntervals;
+};
+
+
+// Partial results over a run of consecutive segments. Chunks of one track are
+// accumulated independently and merged in track order.
+struct TimeDistAccumulator {
+    TimeDistAccumulator(double stopSpd = 1.0, int spdBin = 5);
+    void add(double dist, double dt);
+    void merge(const TimeDistAccumulator& other);
+    FinalAnalyzis result() const;
+
+    double stopSpeed;
+    double totalDistance = 0, totalTime = 0, movingTime = 0, maxSpeed = 0;
+    SpeedHistogram speedDistribution;
+    // Depends on every earlier segment, so an accumulator with a segmenter is never split.
+    std::optional<StopMoveSegmenter> segmenter;
+};
+
+struct EleAccumulator {
+    void add(double prevEle, double ele);
+    void merge(const EleAccumulator& other);
+    FinalAnalyzis result() const;
+
+    double minEle = 0, maxEle = 0, elevationGain = 0, elevationLoss = 0;
+};
+
+
+// Causal elevation filter applied point by point before gain/loss accumulation.
+// Moving average and Kalman are O(1) per point, the median is O(window).
+class ElevationFilter final {
+public:
+    enum Kind { MovingAverage, Median, Kalman };
+
+    static ElevationFilter movingAverage(size_t window);
+    static ElevationFilter median(size_t window);
+    // Random-walk model: processNoise is the variance added per point, measurementNoise
+    // the variance of a reading, both in m^2.
+    static ElevationFilter kalman(double processNoise = 0.05, double measurementNoise = 4.0);
+
+    double push(double ele);
+    void reset();
+
+    Kind kind() const { return type; }
+    // Number of trailing readings that fully determine the output, 0 if unbounded.
+    size_t memory() const { return type == Kalman ? 0 : window; }
+
+private:
+    ElevationFilter(Kind k, size_t win, double q, double r);
+
+    Kind type;
+    size_t window;
+    std::vector<double> ring, sorted;
+    size_t head = 0, count = 0;
+    double sum = 0;
+    double processNoise, measurementNoise, estimate = 0, variance = 0;
 };
 
+// Anything that waits for pool tasks goes through helpUntil, which runs queued
+// tasks on the waiting thread. A caller that is itself a pool task would otherwise
+// hold its worker while it waits, and with every worker waiting the pool deadlocks.
+class ThreadPool final {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
+    template<class F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        auto job = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+        auto res = job->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopping) {
+                throw std::runtime_error("error: thread pool stopped");
+            }
+            tasks.emplace([job] { (*job)(); });
+        }
+        cv.notify_one();
+        return res;
+    }
+    size_t size() const;
+
+    // Runs one queued task on the calling thread; false when the queue is empty.
+    bool runPending();
+    // Returns once done() holds, running queued tasks meanwhile.
+    template<class Done>
+    void helpUntil(Done done) {
+        while (!done()) {
+            if (runPending()) continue;
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return !tasks.empty(); });
+        }
+        // a submit may have woken this thread instead of an idle worker
+        cv.notify_one();
+    }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+};
 
 
 class TrackAnalyzer {
 public:
     TrackAnalyzer(const std::vector<TrackPoint>& pts);
+    TrackAnalyzer(const MappedTrack& track);
+    TrackAnalyzer(const CompressedTrack& track);
     virtual FinalAnalyzis Analyze(double stopSpeed = 1.0, int speedBin = 5) = 0;
     virtual ~TrackAnalyzer() {};
 
-protected:
-    const std::vector<TrackPoint>& points;
+    // Tracks longer than two chunks are split and analyzed on the pool;
+    // nullptr switches back to the sequential loop.
+    void setThreadPool(ThreadPool* pl, size_t chunk = 1 << 16);
 
     static double deg2rad(double deg);
 
     static double haversine(const TrackPoint& a, const TrackPoint& b);
+
+    size_t pointCount() const;
+
+protected:
+    std::variant<const std::vector<TrackPoint>*, const MappedTrack*, const CompressedTrack*> source;
+    ThreadPool* pool = nullptr;
+    size_t chunkSize = 1 << 16;
+
+    // feed(acc, track, begin, end) accumulates segments (i - 1, i) for i in [begin, end).
+    template<class Accumulator, class Feed>
+    Accumulator reduceChunks(const Accumulator& init, Feed feed, bool splittable = true) const {
+        return std::visit([&](const auto* track) {
+            const size_t n = track->size();
+            if (!pool || !splittable || n < 2 * chunkSize) {
+                Accumulator acc = init;
+                feed(acc, *track, 1, n);
+                return acc;
+            }
+            std::vector<std::future<Accumulator>> parts;
+            for (size_t begin = 1; begin < n; begin += chunkSize) {
+                size_t end = std::min(n, begin + chunkSize);
+                parts.push_back(pool->submit([&init, &feed, track, begin, end] {
+                    Accumulator acc = init;
+                    feed(acc, *track, begin, end);
+                    return acc;
+                }));
+            }
+            for (auto& part : parts) {
+                pool->helpUntil([&part] { return part.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+            }
+            Accumulator total = init;
+            for (auto& part : parts) {
+                total.merge(part.get());
+            }
+            return total;
+        }, source);
+    }
 };
 
 class EleAnalyzer final:public TrackAnalyzer {
 public:
     EleAnalyzer(const std::vector<TrackPoint>& pts);
+    EleAnalyzer(const MappedTrack& track);
+    EleAnalyzer(const CompressedTrack& track);
+
+    // Elevations pass through the filter before accumulation; std::nullopt restores raw
+    // deltas. Windowed filters still split across the pool, Kalman runs sequentially.
+    void setFilter(std::optional<ElevationFilter> f);
 
     FinalAnalyzis Analyze(double stopSpeed = 1.0, int speedBin = 5) override;
+
+private:
+    std::optional<ElevationFilter> filter;
 };
 
 
 
-class TimeDistAnalyzer final:public TrackAnalyzer{
+// The distance model is a policy so it inlines into the segment loop.
+template<class Metric = HaversineMetric>
+class BasicTimeDistAnalyzer final:public TrackAnalyzer{
 public:
-    TimeDistAnalyzer(const std::vector<TrackPoint>& pts);
+    BasicTimeDistAnalyzer(const std::vector<TrackPoint>& pts) : TrackAnalyzer(pts) {}
+    BasicTimeDistAnalyzer(const MappedTrack& track) : TrackAnalyzer(track) {}
+    BasicTimeDistAnalyzer(const CompressedTrack& track) : TrackAnalyzer(track) {}
 
-    FinalAnalyzis Analyze(double stopSpeed = 1.0, int speedBin = 5) override;
+    // Adds FinalAnalyzis::motionIntervals, split at Analyze's stopSpeed and at moveSpeed;
+    // the track is then analyzed in one sequential pass.
+    void setSegmentation(double moveSpeed, double minStopDuration) {
+        segmentation = { moveSpeed, minStopDuration };
+    }
+
+    FinalAnalyzis Analyze(double stopSpeed = 1.0, int speedBin = 5) override {
+        if (pointCount() < 2) {
+            throw std::runtime_error("error: Wrong type");
+        }
+        TimeDistAccumulator init(stopSpeed, speedBin);
+        if (segmentation) {
+            init.segmenter.emplace(stopSpeed, segmentation->first, segmentation->second);
+        }
+        TimeDistAccumulator acc = reduceChunks(init,
+            [](TimeDistAccumulator& part, const auto& track, size_t begin, size_t end) {
+                forEachSegment(track, begin, end, [&part](const TrackPoint& a, const TrackPoint& b) {
+                    part.add(Metric::distance(a, b), difftime(b.time, a.time));
+                });
+            }, !segmentation);
+        return acc.result();
+    }
+
+private:
+    std::optional<std::pair<double, double>> segmentation;
+};
+
+using TimeDistAnalyzer = BasicTimeDistAnalyzer<HaversineMetric>;
+
+// Times each metric alone over the segments of the track and reports its total
+// distance error against Vincenty.
+void benchmarkDistanceMetrics(std::ostream& out, const std::vector<TrackPoint>& points);
 
+struct SyntheticTrackOptions {
+    size_t points = 1000;
+    double interval = 1;      // seconds between fixes
+    double speed = 20;        // km/h while moving
+    double noise = 3;         // meters of position noise
+    double stopRate = 0.001;  // chance per fix of starting a stop
+    double stopDuration = 60; // seconds
+    uint64_t seed = 1;
+};
+
+class TrackGenerator final {
+public:
+    TrackGenerator() = delete;
+    // A wandering ride with speed jitter, stops and a smooth elevation profile.
+    static std::vector<TrackPoint> generate(const SyntheticTrackOptions& opt);
+    // oneLine puts each <trkpt> with its children on one line instead of the indented
+    // layout of real devices; GPXParser reads both.
+    static void writeGpx(const std::vector<TrackPoint>& points, const std::string& filename, bool oneLine = false);
 };
 
+// For each size: generation, GPX writing, parsing, cache and compressed-track decoding,
+// both analyzers (sequential and on a pool) and every output format, one line per stage.
+// Outputs are timed on one record per thousand points.
+// 100M points need about 12 GB of disk in workDir and 4 GB of memory; the files of
+// each size are removed once it is done.
+void benchmarkPipeline(std::ostream& out, const std::vector<size_t>& sizes, const std::string& workDir = ".");
 
 
+
+// Online counterpart of TimeDistAnalyzer + EleAnalyzer for live feeds: O(1) per
+// point, safe to feed from one thread while others take snapshots.
+class StreamingTrackAnalyzer final {
+public:
+    StreamingTrackAnalyzer(double stopSpeed = 1.0, int speedBin = 5);
+    // Must be called before the first point, throws otherwise.
+    void setSegmentation(double moveSpeed, double minStopDuration);
+
+    void addPoint(const TrackPoint& pt);
+    void addPoints(const std::vector<TrackPoint>& pts);
+
+    // Totals over every point added so far; all fields are empty until two points arrived.
+    FinalAnalyzis snapshot() const;
+    size_t size() const;
+
+private:
+    void append(const TrackPoint& pt);
+
+    mutable std::mutex mtx;
+    TimeDistAccumulator timeDist;
+    EleAccumulator ele;
+    TrackPoint last{};
+    size_t count = 0;
+};
+
+
+// Downsampling of a track; both methods keep the first and the last point and return
+// ordinary TrackPoints that any TrackAnalyzer accepts.
+class TrackSimplifier final {
+public:
+    TrackSimplifier() = delete;
+
+    // Keeps every point farther than toleranceMeters from the simplified polyline.
+    // With a pool, sub-ranges longer than parallelGrain are split across its threads.
+    static std::vector<TrackPoint> douglasPeucker(const std::vector<TrackPoint>& points, double toleranceMeters,
+        ThreadPool* pool = nullptr, size_t parallelGrain = 1 << 15);
+
+    // Drops points in order of their effective triangle area until the smallest
+    // remaining area reaches toleranceMeters^2.
+    static std::vector<TrackPoint> visvalingam(const std::vector<TrackPoint>& points, double toleranceMeters);
+
+private:
+    struct XY {
+        double x, y;
+    };
+    // Local equirectangular projection in meters, precise enough at track scale.
+    static std::vector<XY> project(const std::vector<TrackPoint>& points);
+    static double segmentDistance(const XY& p, const XY& a, const XY& b);
+    static double triangleArea(const XY& a, const XY& b, const XY& c);
+};
+
+
+struct PointRef {
+    uint32_t track;
+    uint32_t index;
+};
+
+// Packed R-tree over the points of many tracks, bulk loaded with Sort-Tile-Recursive.
+// Coordinates are stored as 1e-7 degree integers, 16 bytes per point.
+class TrackIndex final {
+public:
+    static constexpr size_t NODE_SIZE = 16;
+
+    explicit TrackIndex(const std::vector<std::vector<TrackPoint>>& tracks);
+
+    size_t size() const { return entries.size(); }
+
+    std::vector<PointRef> inBox(double minLat, double minLon, double maxLat, double maxLon) const;
+    // Ids of the tracks with at least one point in the box, ascending.
+    std::vector<uint32_t> tracksInBox(double minLat, double minLon, double maxLat, double maxLon) const;
+    std::vector<PointRef> inRadius(double lat, double lon, double radiusMeters) const;
+    // Up to k points ordered by distance, with the distance in meters.
+    std::vector<std::pair<PointRef, double>> nearest(double lat, double lon, size_t k) const;
+
+private:
+    struct Entry {
+        int32_t lat, lon;
+        PointRef ref;
+    };
+    struct Box {
+        int32_t minLat, minLon, maxLat, maxLon;
+        bool intersects(const Box& b) const {
+            return minLat <= b.maxLat && b.minLat <= maxLat && minLon <= b.maxLon && b.minLon <= maxLon;
+        }
+        bool contains(int32_t lat, int32_t lon) const {
+            return minLat <= lat && lat <= maxLat && minLon <= lon && lon <= maxLon;
+        }
+    };
+
+    static int32_t toFixed(double deg);
+    static double toDeg(int32_t fixed);
+    static Box makeBox(double minLat, double minLon, double maxLat, double maxLon);
+    // Great-circle distance in meters from (lat, lon) to the nearest point of the box,
+    // so a lower bound for every entry inside it.
+    static double boxDistance(double lat, double lon, const Box& b);
+    template<class F>
+    void visitBox(const Box& query, F&& fn) const;
+
+    std::vector<Entry> entries;
+    // levels[0] bounds runs of NODE_SIZE entries, levels[l] bounds runs of NODE_SIZE boxes of levels[l - 1].
+    std::vector<std::vector<Box>> levels;
+};
+
+
+// Position at any timestamp of a track whose fix times never decrease. Lookups
+// start from an interpolated guess and gallop outwards, so evenly sampled tracks
+// cost O(1) and any track at most O(log n). The track must outlive the index.
+class TimeIndex final {
+public:
+    explicit TimeIndex(const std::vector<TrackPoint>& pts);
+
+    // Index of the last fix at or before t, clamped to the track.
+    size_t segmentAt(double t) const;
+    // Linear interpolation between the surrounding fixes; std::nullopt outside the track.
+    std::optional<TrackPoint> at(double t) const;
+    // One point every period seconds from the first fix to the last, in a single pass.
+    std::vector<TrackPoint> resample(double period) const;
+
+    double startTime() const { return times.empty() ? 0 : times.front(); }
+    double endTime() const { return times.empty() ? 0 : times.back(); }
+
+private:
+    const std::vector<TrackPoint>& points;
+    std::vector<double> times;
+};
+
+struct SplitSpec {
+    enum Kind { Distance, Time };
+    Kind kind;
+    double width; // km for Distance, seconds for Time
+};
+
+struct Split {
+    uint32_t spec;   // index into the SplitSpec list
+    uint32_t number; // 0-based within its spec; the last one of a spec may be partial
+    double startDistance, startTime; // from the first point, km and seconds
+    double distance, duration;
+    double elevationGain, elevationLoss;
+};
+
+// Per-distance and per-time splits (laps) for any number of widths in one pass.
+// Boundaries fall inside segments, where distance, time and elevation are
+// interpolated linearly.
+class SplitAggregator final {
+public:
+    explicit SplitAggregator(std::vector<SplitSpec> specs);
+
+    void add(const TrackPoint& a, const TrackPoint& b);
+    // All splits grouped by spec, then in track order.
+    std::vector<Split> finish() const;
+
+    template<class Track>
+    static std::vector<Split> compute(const Track& track, const std::vector<SplitSpec>& specs) {
+        SplitAggregator agg(specs);
+        forEachSegment(track, 1, track.size(), [&agg](const TrackPoint& a, const TrackPoint& b) { agg.add(a, b); });
+        return agg.finish();
+    }
+
+private:
+    struct Open {
+        double nextBoundary;
+        double startDistance, startTime, startEle;
+        double gain = 0, loss = 0;
+        uint32_t number = 0;
+    };
+    void close(size_t spec, double distance, double time, double ele);
+
+    std::vector<SplitSpec> specs;
+    std::vector<Open> open;
+    std::vector<std::vector<Split>> done;
+    double distance = 0, time = 0;
+    bool started = false;
+};
+
+
+// MinHash fingerprint of the set of geohash k-grams a track passes through.
+struct TrackFingerprint {
+    std::vector<uint32_t> signature;
+    size_t shingles = 0;
+};
+
+// Tracks become sequences of geohash cells (repeats collapsed, so the sampling
+// rate does not matter); every run of shingleLength cells is one shingle.
+class MinHasher final {
+public:
+    MinHasher(size_t hashes = 128, unsigned geohashPrecision = 7, size_t shingleLength = 2, uint64_t seed = 0x9E3779B97F4A7C15ull);
+
+    // Standard geohash bit interleaving (longitude first), 5 bits per character.
+    static uint64_t geohash(double lat, double lon, unsigned precision);
+
+    std::vector<uint64_t> shingles(const std::vector<TrackPoint>& points) const;
+    TrackFingerprint fingerprint(const std::vector<TrackPoint>& points) const;
+    size_t size() const { return seeds.size(); }
+
+private:
+    std::vector<uint64_t> seeds;
+    unsigned precision;
+    size_t shingleLength;
+};
+
+struct TrackMatch {
+    uint32_t a, b;
+    double jaccard;     // estimated from the signatures
+    double containment; // shared shingles over those of the shorter track
+};
+
+// Banded LSH over MinHash signatures: two tracks become candidates when all rows
+// of at least one band agree, so the work is linear in the number of tracks plus
+// the bucket pairs. Pairs with Jaccard s are found with probability 1 - (1 - s^rows)^bands.
+//
+// A short track inside a long one has high containment but a small Jaccard, so
+// full bands miss it. For containment the index works like an LSH Ensemble: tracks
+// are also bucketed by every band prefix of 1..rows hashes, within power-of-two
+// partitions of the shingle count. A query picks per partition the longest prefix
+// that still finds the lowest Jaccard the size range allows for the containment
+// threshold.
+class LshIndex final {
+public:
+    LshIndex(size_t bands = 32, size_t rows = 4);
+
+    // Signatures must have bands * rows hashes. Returns the track id.
+    uint32_t add(TrackFingerprint fp);
+    // Tracks sharing a full band with fp, plus those that may contain fp or be
+    // contained in it with at least minContainment.
+    std::vector<uint32_t> candidates(const TrackFingerprint& fp, double minContainment = 0.85) const;
+    // Candidate pairs kept when either threshold is met.
+    std::vector<TrackMatch> findSimilar(double minJaccard = 0.7, double minContainment = 0.85) const;
+
+    const TrackFingerprint& operator[](uint32_t id) const { return tracks[id]; }
+    size_t size() const { return tracks.size(); }
+
+    static double jaccard(const TrackFingerprint& a, const TrackFingerprint& b);
+    static TrackMatch compare(uint32_t ia, const TrackFingerprint& a, uint32_t ib, const TrackFingerprint& b);
+
+private:
+    static size_t partitionOf(size_t shingles);
+    uint64_t bandKey(const TrackFingerprint& fp, size_t band) const;
+    uint64_t prefixKey(const TrackFingerprint& fp, size_t partition, size_t band, size_t prefix) const;
+    // Longest band prefix that finds pairs with Jaccard s at least 90% of the time.
+    size_t prefixFor(double s) const;
+    // Containment candidates from partitions firstPartition and up.
+    void containmentCandidates(const TrackFingerprint& fp, double minContainment, size_t firstPartition, std::vector<uint32_t>& out) const;
+
+    size_t bands, rows;
+    std::vector<TrackFingerprint> tracks;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> prefixBuckets;
+    uint64_t partitions = 0; // bit p set when partition p is not empty
+};
+
+// One record per track: name, point count, the scalar FinalAnalyzis fields
+// (taken from the first part that has them) and an error message. Output goes
+// through one reusable buffer, numbers are formatted with to_chars.
+//   Csv       - ';' separated with a header line, absent fields are empty.
+//   JsonLines - one object per line, absent fields are null, plus the speed histogram.
+//   Binary    - header {MAGIC, VERSION, field count}, then per record: u32 name length,
+//               name, u64 points, u32 mask of present fields, the fields as doubles
+//               (NaN when absent), u32 error length, error.
+class RecordWriter final {
+public:
+    enum Format { Csv, JsonLines, Binary };
+    static constexpr uint32_t MAGIC = 0x52535047; // "GPSR"
+    static constexpr uint32_t VERSION = 1;
+
+    RecordWriter(const std::string& file, Format fmt, size_t bufferBytes = 1 << 20);
+    ~RecordWriter();
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    void write(std::string_view name, uint64_t points,
+        std::initializer_list<std::reference_wrapper<const FinalAnalyzis>> parts, std::string_view error = {});
+    void write(std::string_view name, uint64_t points, const std::vector<FinalAnalyzis>& parts, std::string_view error = {});
+    // Throws when any write so far has failed. The destructor only writes out the
+    // buffer and cannot report errors, so finish with flush().
+    void flush();
+
+    // Csv for *.csv, JsonLines for *.jsonl and *.json, Binary for *.bin.
+    static std::optional<Format> formatFor(const std::string& file);
+
+private:
+    template<class Parts>
+    void writeRecord(std::string_view name, uint64_t points, const Parts& parts, std::string_view error);
+    void put(char c);
+    void put(std::string_view s);
+    void putQuoted(std::string_view s);
+    void putNumber(double v);
+    void putNumber(uint64_t v);
+    template<class T>
+    void putRaw(T v) {
+        put(std::string_view(reinterpret_cast<const char*>(&v), sizeof(v)));
+    }
+    void spill();
+
+    std::ofstream out;
+    std::string fileName;
+    Format format;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
 class AnalysisSaver {
     std::vector<TrackAnalyzer*> Analyzers;
+    std::vector<FinalAnalyzis> Results;
 public:
     void adddAnalyzer(TrackAnalyzer* A) {
         Analyzers.push_back(A);
     }
+    // Analyzers run once, on first use; later saves reuse the results.
+    const std::vector<FinalAnalyzis>& results();
     void saveAnalysis(const std::string& outFile);
-};
\ No newline at end of file
+    // All analyzers go into a single record.
+    void saveAnalysis(const std::string& outFile, RecordWriter::Format format, std::string_view name = {});
+    static void writeAnalysis(std::ostream& out, const FinalAnalyzis& analyzer);
+};
+
+
+template<class T>
+class BoundedQueue final {
+public:
+    explicit BoundedQueue(size_t cap) : capacity(std::max<size_t>(cap, 1)) {}
+
+    // Blocks while the queue is full. Returns false once the queue is closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns nullopt once it is closed and drained.
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return std::nullopt;
+        T item = std::move(items.front());
+        items.pop();
+        notFull.notify_one();
+        return item;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::queue<T> items;
+    std::mutex mtx;
+    std::condition_variable notFull, notEmpty;
+    bool closed = false;
+};
+
+
+struct TrackSummary {
+    std::string file;
+    size_t points = 0;
+    std::optional<FinalAnalyzis> timeDist, ele;
+    std::string error;
+};
+
+struct BatchStats {
+    size_t files = 0, failed = 0, points = 0;
+    double seconds = 0;
+    double filesPerSecond() const { return seconds > 0 ? files / seconds : 0; }
+    double pointsPerSecond() const { return seconds > 0 ? points / seconds : 0; }
+};
+
+class BatchProcessor final {
+public:
+    BatchProcessor(size_t parsers = 2, size_t analyzers = std::thread::hardware_concurrency(), size_t queueCap = 64);
+
+    // A directory is scanned recursively for *.gpx, a *.gpx path is taken as is,
+    // anything else is read as a list with one path per line.
+    static std::vector<std::string> collectInputs(const std::string& dirOrList);
+
+    // Parser threads -> queue -> analyzer threads -> queue -> the calling thread,
+    // which writes the per-file summary and, at the end, the aggregated report.
+    // The summary format follows the extension (see RecordWriter::formatFor), CSV otherwise.
+    BatchStats run(const std::vector<std::string>& files, const std::string& reportFile, const std::string& summaryFile) const;
+
+    // With the cache on, <file>.gpx.trk is mapped instead of parsing the XML when it is
+    // not older than the GPX file, and written after parsing otherwise.
+    void setCache(bool on);
+
+private:
+    size_t parserThreads, analyzerThreads, queueCapacity;
+    bool useCache = false;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <ctime>
+
+// Point type and great-circle distance shared with the modules built on GPS tracks.
+
+struct TrackPoint {
+    double lat, lon, ele;
+    std::time_t time;
+};
+
+// Distance policies for BasicTimeDistAnalyzer, all in kilometres; the others live in GPS.h.
+struct HaversineMetric {
+    static double distance(const TrackPoint& a, const TrackPoint& b) {
+        static const double R = 6371.0;
+        double dLat = (b.lat - a.lat) * M_PI / 180.0;
+        double dLon = (b.lon - a.lon) * M_PI / 180.0;
+        double lat1 = a.lat * M_PI / 180.0;
+        double lat2 = b.lat * M_PI / 180.0;
+        double h = pow(sin(dLat / 2), 2) + cos(lat1) * cos(lat2) * pow(sin(dLon / 2), 2);
+        return 2 * R * asin(sqrt(h));
+    }
+};
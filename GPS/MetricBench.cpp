@@ -0,0 +1,43 @@
+#include "GPS.h"
+
+namespace {
+template<class Metric>
+double totalDistance(const std::vector<TrackPoint>& points) {
+    double dist = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+        dist += Metric::distance(points[i - 1], points[i]);
+    }
+    return dist;
+}
+
+// Only the metric is timed: no histogram, speeds or allocation around it.
+template<class Metric>
+void benchMetric(std::ostream& out, const std::string& name, const std::vector<TrackPoint>& points, double reference) {
+    double dist = 0;
+    size_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{ 0 };
+    while (elapsed.count() < 0.2) {
+        dist = totalDistance<Metric>(points);
+        ++runs;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    double nsPerSegment = elapsed.count() * 1e9 / (runs * (points.size() - 1));
+    out << std::left << std::setw(16) << name << std::right
+        << std::setw(10) << std::fixed << std::setprecision(1) << nsPerSegment << " ns/segment"
+        << std::setw(16) << std::setprecision(6) << dist << " km"
+        << std::setw(12) << std::scientific << std::setprecision(2) << (dist - reference) / reference << " rel. error\n";
+    out << std::defaultfloat;
+}
+}
+
+void benchmarkDistanceMetrics(std::ostream& out, const std::vector<TrackPoint>& points) {
+    if (points.size() < 2) {
+        throw std::runtime_error("error: Wrong type");
+    }
+    double reference = totalDistance<VincentyMetric>(points);
+    out << points.size() << " points, reference (Vincenty) " << reference << " km\n";
+    benchMetric<EquirectangularMetric>(out, "equirectangular", points, reference);
+    benchMetric<HaversineMetric>(out, "haversine", points, reference);
+    benchMetric<VincentyMetric>(out, "vincenty", points, reference);
+}
@@ -0,0 +1,252 @@
+#include "GPS.h"
+
+namespace {
+    struct Field {
+        const char* name;
+        std::optional<double> FinalAnalyzis::* member;
+    };
+
+    const Field FIELDS[] = {
+        { "min_ele", &FinalAnalyzis::minEle },
+        { "max_ele", &FinalAnalyzis::maxEle },
+        { "ele_gain", &FinalAnalyzis::elevationGain },
+        { "ele_loss", &FinalAnalyzis::elevationLoss },
+        { "total_time", &FinalAnalyzis::totalTime },
+        { "distance", &FinalAnalyzis::totalDistance },
+        { "avg_speed", &FinalAnalyzis::avgSpeed },
+        { "moving_time", &FinalAnalyzis::movingTime },
+        { "avg_moving_speed", &FinalAnalyzis::avgMovingSpeed },
+        { "max_speed", &FinalAnalyzis::maxSpeed },
+    };
+    constexpr uint32_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+}
+
+RecordWriter::RecordWriter(const std::string& file, Format fmt, size_t bufferBytes)
+    : out(file, std::ios::binary), fileName(file), format(fmt), buffer(std::max<size_t>(bufferBytes, 4096)) {
+    if (!out) {
+        throw std::runtime_error("error: cannot open " + file);
+    }
+    if (format == Csv) {
+        put("name;points");
+        for (const Field& f : FIELDS) {
+            put(';');
+            put(f.name);
+        }
+        put(";error\n");
+    }
+    else if (format == Binary) {
+        putRaw(MAGIC);
+        putRaw(VERSION);
+        putRaw(FIELD_COUNT);
+    }
+}
+
+// Cannot report a failure, which is why callers flush() themselves.
+RecordWriter::~RecordWriter() {
+    spill();
+}
+
+std::optional<RecordWriter::Format> RecordWriter::formatFor(const std::string& file) {
+    auto endsWith = [&file](std::string_view ext) {
+        return file.size() >= ext.size() && file.compare(file.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (endsWith(".csv")) return Csv;
+    if (endsWith(".jsonl") || endsWith(".json")) return JsonLines;
+    if (endsWith(".bin")) return Binary;
+    return std::nullopt;
+}
+
+void RecordWriter::spill() {
+    if (used > 0) {
+        out.write(buffer.data(), used);
+        used = 0;
+    }
+}
+
+// Stream errors are sticky, so one check here covers every earlier write.
+void RecordWriter::flush() {
+    spill();
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("error: cant write " + fileName);
+    }
+}
+
+void RecordWriter::put(char c) {
+    if (used == buffer.size()) spill();
+    buffer[used++] = c;
+}
+
+void RecordWriter::put(std::string_view s) {
+    if (used + s.size() > buffer.size()) {
+        spill();
+        if (s.size() > buffer.size()) {
+            out.write(s.data(), s.size());
+            return;
+        }
+    }
+    std::copy(s.begin(), s.end(), buffer.data() + used);
+    used += s.size();
+}
+
+// CSV fields are quoted only when they contain a separator, quote or line break;
+// JSON strings are always quoted and escaped.
+void RecordWriter::putQuoted(std::string_view s) {
+    if (format == Csv) {
+        if (s.find_first_of(";\"\r\n") == std::string_view::npos) {
+            put(s);
+            return;
+        }
+        put('"');
+        for (char c : s) {
+            if (c == '"') put('"');
+            put(c);
+        }
+        put('"');
+        return;
+    }
+    put('"');
+    for (char c : s) {
+        switch (c) {
+        case '"': put("\\\""); break;
+        case '\\': put("\\\\"); break;
+        case '\n': put("\\n"); break;
+        case '\r': put("\\r"); break;
+        case '\t': put("\\t"); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                const char* hex = "0123456789abcdef";
+                put("\\u00");
+                put(hex[(c >> 4) & 0xF]);
+                put(hex[c & 0xF]);
+            }
+            else {
+                put(c);
+            }
+        }
+    }
+    put('"');
+}
+
+void RecordWriter::putNumber(double v) {
+    if (!std::isfinite(v)) {
+        put(format == JsonLines ? "null" : "");
+        return;
+    }
+    char tmp[32];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    put(std::string_view(tmp, res.ptr - tmp));
+}
+
+void RecordWriter::putNumber(uint64_t v) {
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    put(std::string_view(tmp, res.ptr - tmp));
+}
+
+template<class Parts>
+void RecordWriter::writeRecord(std::string_view name, uint64_t points, const Parts& parts, std::string_view error) {
+    std::optional<double> values[FIELD_COUNT];
+    const SpeedHistogram* hist = nullptr;
+    for (const FinalAnalyzis& part : parts) {
+        for (uint32_t i = 0; i < FIELD_COUNT; ++i) {
+            if (!values[i]) values[i] = part.*FIELDS[i].member;
+        }
+        if (!hist && part.speedDistribution) hist = &*part.speedDistribution;
+    }
+
+    switch (format) {
+    case Csv:
+        putQuoted(name);
+        put(';');
+        putNumber(points);
+        for (const auto& v : values) {
+            put(';');
+            if (v) putNumber(*v);
+        }
+        put(';');
+        putQuoted(error);
+        put('\n');
+        break;
+
+    case JsonLines:
+        put("{\"name\":");
+        putQuoted(name);
+        put(",\"points\":");
+        putNumber(points);
+        for (uint32_t i = 0; i < FIELD_COUNT; ++i) {
+            put(",\"");
+            put(FIELDS[i].name);
+            put("\":");
+            if (values[i]) putNumber(*values[i]);
+            else put("null");
+        }
+        if (hist) {
+            put(",\"speed_histogram\":{\"width\":");
+            putNumber(static_cast<uint64_t>(hist->binWidth()));
+            put(",\"bins\":[");
+            bool first = true;
+            for (size_t bin = 0; bin < hist->binCount(); ++bin) {
+                if ((*hist)[bin] > 0) {
+                    if (!first) put(',');
+                    first = false;
+                    put('[');
+                    putNumber(static_cast<uint64_t>(hist->binStart(bin)));
+                    put(',');
+                    putNumber((*hist)[bin]);
+                    put(']');
+                }
+            }
+            put("]}");
+        }
+        if (!error.empty()) {
+            put(",\"error\":");
+            putQuoted(error);
+        }
+        put("}\n");
+        break;
+
+    case Binary: {
+        putRaw(static_cast<uint32_t>(name.size()));
+        put(name);
+        putRaw(points);
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < FIELD_COUNT; ++i) {
+            if (values[i]) mask |= 1u << i;
+        }
+        putRaw(mask);
+        for (const auto& v : values) {
+            putRaw(v ? *v : std::numeric_limits<double>::quiet_NaN());
+        }
+        putRaw(static_cast<uint32_t>(error.size()));
+        put(error);
+        break;
+    }
+    }
+}
+
+void RecordWriter::write(std::string_view name, uint64_t points,
+    std::initializer_list<std::reference_wrapper<const FinalAnalyzis>> parts, std::string_view error) {
+    writeRecord(name, points, parts, error);
+}
+
+void RecordWriter::write(std::string_view name, uint64_t points, const std::vector<FinalAnalyzis>& parts, std::string_view error) {
+    writeRecord(name, points, parts, error);
+}
+
+const std::vector<FinalAnalyzis>& AnalysisSaver::results() {
+    while (Results.size() < Analyzers.size()) {
+        Results.push_back(Analyzers[Results.size()]->Analyze());
+    }
+    return Results;
+}
+
+void AnalysisSaver::saveAnalysis(const std::string& outFile, RecordWriter::Format format, std::string_view name) {
+    uint64_t points = 0;
+    for (TrackAnalyzer* a : Analyzers) {
+        points = std::max<uint64_t>(points, a->pointCount());
+    }
+    RecordWriter writer(outFile, format);
+    writer.write(name, points, results());
+    writer.flush();
+}
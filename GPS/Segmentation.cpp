@@ -0,0 +1,83 @@
+#include "GPS.h"
+
+StopMoveSegmenter::StopMoveSegmenter(double stopSpd, double moveSpd, double minStop)
+    : stopSpeed(stopSpd), moveSpeed(std::max(moveSpd, stopSpd)), minStopDuration(minStop) {}
+
+void StopMoveSegmenter::extend(MotionInterval& iv, size_t index, double dist, double dt) {
+    iv.end = index;
+    iv.duration += std::max(dt, 0.0);
+    iv.distance += dist;
+}
+
+void StopMoveSegmenter::add(double dist, double dt) {
+    size_t index = next++;
+    if (dt <= 0) {
+        // no speed to classify, the segment stays with whatever is open
+        extend(state == State::Moving ? moving : stop, index, dist, dt);
+        return;
+    }
+    double speed = dist / (dt / 3600.0);
+    switch (state) {
+    case State::Moving:
+        if (speed <= stopSpeed) {
+            stop = { index - 1, index, dt, dist, false };
+            state = State::CandidateStop;
+            confirmStop();
+        }
+        else {
+            extend(moving, index, dist, dt);
+        }
+        break;
+    case State::CandidateStop:
+        if (speed > moveSpeed) {
+            // confirmStop() runs every time the candidate grows, so one still open
+            // here is too short to be a stop: fold it back into the movement
+            moving.duration += stop.duration;
+            moving.distance += stop.distance;
+            extend(moving, index, dist, dt);
+            state = State::Moving;
+            break;
+        }
+        extend(stop, index, dist, dt);
+        confirmStop();
+        break;
+    case State::Stopped:
+        if (speed > moveSpeed) {
+            closed.push_back(stop);
+            moving = { index - 1, index, dt, dist, true };
+            state = State::Moving;
+        }
+        else {
+            extend(stop, index, dist, dt);
+        }
+        break;
+    }
+}
+
+void StopMoveSegmenter::confirmStop() {
+    if (stop.duration >= minStopDuration) {
+        if (moving.end > moving.begin) closed.push_back(moving);
+        state = State::Stopped;
+    }
+}
+
+std::vector<MotionInterval> StopMoveSegmenter::intervals() const {
+    std::vector<MotionInterval> res = closed;
+    switch (state) {
+    case State::Moving:
+        if (moving.end > moving.begin) res.push_back(moving);
+        break;
+    case State::CandidateStop: {
+        MotionInterval tail = moving;
+        tail.end = stop.end;
+        tail.duration += stop.duration;
+        tail.distance += stop.distance;
+        res.push_back(tail);
+        break;
+    }
+    case State::Stopped:
+        res.push_back(stop);
+        break;
+    }
+    return res;
+}
@@ -0,0 +1,134 @@
+#include "GPS.h"
+
+std::vector<TrackSimplifier::XY> TrackSimplifier::project(const std::vector<TrackPoint>& points) {
+    static const double R = 6371000.0;
+    std::vector<XY> xy(points.size());
+    if (points.empty()) return xy;
+    double lat0 = points[0].lat, lon0 = points[0].lon;
+    double kx = R * std::cos(TrackAnalyzer::deg2rad(lat0)) * M_PI / 180.0;
+    double ky = R * M_PI / 180.0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        xy[i] = { (points[i].lon - lon0) * kx, (points[i].lat - lat0) * ky };
+    }
+    return xy;
+}
+
+double TrackSimplifier::segmentDistance(const XY& p, const XY& a, const XY& b) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0;
+    t = std::clamp(t, 0.0, 1.0);
+    double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+double TrackSimplifier::triangleArea(const XY& a, const XY& b, const XY& c) {
+    return std::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) / 2;
+}
+
+
+std::vector<TrackPoint> TrackSimplifier::douglasPeucker(const std::vector<TrackPoint>& points, double toleranceMeters,
+    ThreadPool* pool, size_t parallelGrain) {
+    if (points.size() < 3) return points;
+    const std::vector<XY> xy = project(points);
+    // one byte per point, each written by exactly one task
+    std::vector<char> keep(points.size(), 0);
+    keep.front() = keep.back() = 1;
+
+    std::atomic<size_t> pending{ 0 };
+    std::function<void(size_t, size_t)> simplifyRange;
+
+    // Large halves are handed to the pool instead of waited on; only the caller
+    // waits, and it helps with the queue meanwhile.
+    auto spawn = [&](size_t a, size_t b) {
+        ++pending;
+        pool->submit([&, a, b] {
+            simplifyRange(a, b);
+            --pending;
+        });
+    };
+    simplifyRange = [&](size_t first, size_t last) {
+        std::vector<std::pair<size_t, size_t>> stack{ { first, last } };
+        while (!stack.empty()) {
+            auto [a, b] = stack.back();
+            stack.pop_back();
+            if (b <= a + 1) continue;
+            double maxDist = -1;
+            size_t split = a;
+            for (size_t i = a + 1; i < b; ++i) {
+                double d = segmentDistance(xy[i], xy[a], xy[b]);
+                if (d > maxDist) {
+                    maxDist = d;
+                    split = i;
+                }
+            }
+            if (maxDist <= toleranceMeters) continue;
+            keep[split] = 1;
+            for (auto range : { std::make_pair(a, split), std::make_pair(split, b) }) {
+                if (pool && range.second - range.first > parallelGrain) spawn(range.first, range.second);
+                else stack.push_back(range);
+            }
+        }
+    };
+
+    if (pool && points.size() > parallelGrain) {
+        spawn(0, points.size() - 1);
+        pool->helpUntil([&pending] { return pending == 0; });
+    }
+    else {
+        simplifyRange(0, points.size() - 1);
+    }
+
+    std::vector<TrackPoint> res;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) res.push_back(points[i]);
+    }
+    return res;
+}
+
+
+std::vector<TrackPoint> TrackSimplifier::visvalingam(const std::vector<TrackPoint>& points, double toleranceMeters) {
+    const size_t n = points.size();
+    if (n < 3) return points;
+    const std::vector<XY> xy = project(points);
+    const double minArea = toleranceMeters * toleranceMeters;
+
+    std::vector<size_t> prev(n), next(n);
+    std::vector<double> area(n, std::numeric_limits<double>::infinity());
+    std::vector<char> removed(n, 0);
+    using Entry = std::pair<double, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    for (size_t i = 0; i < n; ++i) {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+    }
+    for (size_t i = 1; i + 1 < n; ++i) {
+        area[i] = triangleArea(xy[i - 1], xy[i], xy[i + 1]);
+        heap.push({ area[i], i });
+    }
+
+    double lastArea = 0;
+    while (!heap.empty()) {
+        auto [a, i] = heap.top();
+        heap.pop();
+        if (removed[i] || a != area[i]) continue; // stale entry
+        if (a >= minArea) break;
+        // effective area never decreases, so earlier removals stay justified
+        lastArea = std::max(lastArea, a);
+        removed[i] = 1;
+        size_t p = prev[i], q = next[i];
+        next[p] = q;
+        prev[q] = p;
+        for (size_t j : { p, q }) {
+            if (j == 0 || j == n - 1) continue;
+            area[j] = std::max(lastArea, triangleArea(xy[prev[j]], xy[j], xy[next[j]]));
+            heap.push({ area[j], j });
+        }
+    }
+
+    std::vector<TrackPoint> res;
+    for (size_t i = 0; i < n; ++i) {
+        if (!removed[i]) res.push_back(points[i]);
+    }
+    return res;
+}
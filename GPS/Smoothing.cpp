@@ -0,0 +1,76 @@
+#include "GPS.h"
+#include <numeric>
+
+ElevationFilter::ElevationFilter(Kind k, size_t win, double q, double r)
+    : type(k), window(win), processNoise(q), measurementNoise(r) {
+    if (type != Kalman) {
+        if (window == 0) {
+            throw std::runtime_error("error: filter window must be positive");
+        }
+        ring.assign(window, 0.0);
+        if (type == Median) sorted.reserve(window);
+    }
+    else if (!(processNoise >= 0) || !(measurementNoise > 0)) {
+        throw std::runtime_error("error: invalid Kalman filter noise");
+    }
+}
+
+ElevationFilter ElevationFilter::movingAverage(size_t window) {
+    return ElevationFilter(MovingAverage, window, 0, 0);
+}
+
+ElevationFilter ElevationFilter::median(size_t window) {
+    return ElevationFilter(Median, window, 0, 0);
+}
+
+ElevationFilter ElevationFilter::kalman(double processNoise, double measurementNoise) {
+    return ElevationFilter(Kalman, 0, processNoise, measurementNoise);
+}
+
+void ElevationFilter::reset() {
+    head = count = 0;
+    sum = 0;
+    sorted.clear();
+    estimate = variance = 0;
+}
+
+double ElevationFilter::push(double ele) {
+    if (type == Kalman) {
+        if (count++ == 0) {
+            estimate = ele;
+            variance = measurementNoise;
+            return estimate;
+        }
+        variance += processNoise;
+        double gain = variance / (variance + measurementNoise);
+        estimate += gain * (ele - estimate);
+        variance *= 1 - gain;
+        return estimate;
+    }
+
+    double evicted = ring[head];
+    bool full = count == window;
+    ring[head] = ele;
+    head = head + 1 == window ? 0 : head + 1;
+    if (!full) ++count;
+
+    if (type == MovingAverage) {
+        // The running sum drifts over a long track, so it is rebuilt from the ring
+        // each time the window wraps: still O(1) per point amortized.
+        if (head == 0) {
+            sum = std::accumulate(ring.begin(), ring.end(), 0.0);
+        }
+        else {
+            sum += ele - (full ? evicted : 0.0);
+        }
+        return sum / count;
+    }
+
+    // The window stays sorted: drop the evicted reading, insert the new one.
+    if (full) {
+        sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), evicted));
+    }
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), ele), ele);
+    size_t mid = count / 2;
+    return count % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
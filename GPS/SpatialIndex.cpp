@@ -0,0 +1,205 @@
+#include "GPS.h"
+
+int32_t TrackIndex::toFixed(double deg) {
+    return static_cast<int32_t>(std::llround(deg * 1e7));
+}
+
+double TrackIndex::toDeg(int32_t fixed) {
+    return fixed * 1e-7;
+}
+
+TrackIndex::Box TrackIndex::makeBox(double minLat, double minLon, double maxLat, double maxLon) {
+    return { toFixed(minLat), toFixed(minLon), toFixed(maxLat), toFixed(maxLon) };
+}
+
+
+TrackIndex::TrackIndex(const std::vector<std::vector<TrackPoint>>& tracks) {
+    size_t total = 0;
+    for (const auto& t : tracks) total += t.size();
+    entries.reserve(total);
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        for (size_t i = 0; i < tracks[t].size(); ++i) {
+            entries.push_back({ toFixed(tracks[t][i].lat), toFixed(tracks[t][i].lon),
+                { static_cast<uint32_t>(t), static_cast<uint32_t>(i) } });
+        }
+    }
+    if (entries.empty()) return;
+
+    // STR: vertical slices by longitude, each slice sorted by latitude
+    size_t leaves = (entries.size() + NODE_SIZE - 1) / NODE_SIZE;
+    size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+    size_t sliceLen = ((leaves + slices - 1) / slices) * NODE_SIZE;
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lon < b.lon; });
+    for (size_t b = 0; b < entries.size(); b += sliceLen) {
+        auto e = entries.begin() + std::min(entries.size(), b + sliceLen);
+        std::sort(entries.begin() + b, e, [](const Entry& x, const Entry& y) { return x.lat < y.lat; });
+    }
+
+    std::vector<Box> level;
+    level.reserve(leaves);
+    for (size_t b = 0; b < entries.size(); b += NODE_SIZE) {
+        Box box{ entries[b].lat, entries[b].lon, entries[b].lat, entries[b].lon };
+        for (size_t i = b + 1; i < std::min(entries.size(), b + NODE_SIZE); ++i) {
+            box.minLat = std::min(box.minLat, entries[i].lat);
+            box.maxLat = std::max(box.maxLat, entries[i].lat);
+            box.minLon = std::min(box.minLon, entries[i].lon);
+            box.maxLon = std::max(box.maxLon, entries[i].lon);
+        }
+        level.push_back(box);
+    }
+    levels.push_back(std::move(level));
+    while (levels.back().size() > 1) {
+        const std::vector<Box>& below = levels.back();
+        std::vector<Box> upper;
+        upper.reserve((below.size() + NODE_SIZE - 1) / NODE_SIZE);
+        for (size_t b = 0; b < below.size(); b += NODE_SIZE) {
+            Box box = below[b];
+            for (size_t i = b + 1; i < std::min(below.size(), b + NODE_SIZE); ++i) {
+                box.minLat = std::min(box.minLat, below[i].minLat);
+                box.maxLat = std::max(box.maxLat, below[i].maxLat);
+                box.minLon = std::min(box.minLon, below[i].minLon);
+                box.maxLon = std::max(box.maxLon, below[i].maxLon);
+            }
+            upper.push_back(box);
+        }
+        levels.push_back(std::move(upper));
+    }
+}
+
+
+template<class F>
+void TrackIndex::visitBox(const Box& query, F&& fn) const {
+    if (levels.empty()) return;
+    std::vector<std::pair<size_t, size_t>> stack{ { levels.size() - 1, 0 } };
+    while (!stack.empty()) {
+        auto [lvl, node] = stack.back();
+        stack.pop_back();
+        if (!levels[lvl][node].intersects(query)) continue;
+        if (lvl == 0) {
+            for (size_t i = node * NODE_SIZE; i < std::min(entries.size(), (node + 1) * NODE_SIZE); ++i) {
+                if (query.contains(entries[i].lat, entries[i].lon)) fn(entries[i]);
+            }
+            continue;
+        }
+        for (size_t c = node * NODE_SIZE; c < std::min(levels[lvl - 1].size(), (node + 1) * NODE_SIZE); ++c) {
+            stack.push_back({ lvl - 1, c });
+        }
+    }
+}
+
+std::vector<PointRef> TrackIndex::inBox(double minLat, double minLon, double maxLat, double maxLon) const {
+    std::vector<PointRef> res;
+    visitBox(makeBox(minLat, minLon, maxLat, maxLon), [&res](const Entry& e) { res.push_back(e.ref); });
+    return res;
+}
+
+std::vector<uint32_t> TrackIndex::tracksInBox(double minLat, double minLon, double maxLat, double maxLon) const {
+    std::vector<uint32_t> res;
+    visitBox(makeBox(minLat, minLon, maxLat, maxLon), [&res](const Entry& e) { res.push_back(e.ref.track); });
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+std::vector<PointRef> TrackIndex::inRadius(double lat, double lon, double radiusMeters) const {
+    static const double R = 6371000.0;
+    // Slack of a few fixed-point steps, so rounding never drops a point on the circle.
+    const double eps = 1e-6;
+    double angle = radiusMeters / R;
+    double dLat = angle * 180.0 / M_PI;
+    double minLat = lat - dLat, maxLat = lat + dLat;
+    // Boxes of the cap; its longitude extent is asin(sin r / cos lat) unless it covers a pole.
+    std::vector<Box> boxes;
+    if (angle >= M_PI || minLat <= -90 || maxLat >= 90) {
+        boxes.push_back(makeBox(std::max(minLat, -90.0), -180, std::min(maxLat, 90.0), 180));
+    }
+    else {
+        double dLon = std::asin(std::min(1.0, std::sin(angle) / std::cos(TrackAnalyzer::deg2rad(lat)))) * 180.0 / M_PI + eps;
+        double west = lon - dLon, east = lon + dLon;
+        minLat -= eps;
+        maxLat += eps;
+        if (east - west >= 360) {
+            boxes.push_back(makeBox(minLat, -180, maxLat, 180));
+        }
+        else if (west < -180) {
+            boxes.push_back(makeBox(minLat, west + 360, maxLat, 180));
+            boxes.push_back(makeBox(minLat, -180, maxLat, east));
+        }
+        else if (east > 180) {
+            boxes.push_back(makeBox(minLat, west, maxLat, 180));
+            boxes.push_back(makeBox(minLat, -180, maxLat, east - 360));
+        }
+        else {
+            boxes.push_back(makeBox(minLat, west, maxLat, east));
+        }
+    }
+    TrackPoint center{ lat, lon, 0, 0 };
+    std::vector<PointRef> res;
+    for (const Box& box : boxes) {
+        visitBox(box, [&](const Entry& e) {
+            TrackPoint p{ toDeg(e.lat), toDeg(e.lon), 0, 0 };
+            if (TrackAnalyzer::haversine(center, p) * 1000.0 <= radiusMeters) res.push_back(e.ref);
+        });
+    }
+    return res;
+}
+
+
+double TrackIndex::boxDistance(double lat, double lon, const Box& b) {
+    const double minLat = toDeg(b.minLat), maxLat = toDeg(b.maxLat);
+    const double minLon = toDeg(b.minLon), maxLon = toDeg(b.maxLon);
+    TrackPoint q{ lat, lon, 0, 0 };
+    auto meters = [&q](double pLat, double pLon) { return TrackAnalyzer::haversine(q, { pLat, pLon, 0, 0 }) * 1000.0; };
+    // Inside the longitude range the nearest point is straight north or south.
+    if (minLon <= lon && lon <= maxLon) {
+        return meters(std::clamp(lat, minLat, maxLat), lon);
+    }
+    // Otherwise it lies on one of the edge meridians: at an end of the edge, or where
+    // the edge passes closest, at latitude atan2(sin lat, cos lat * cos dLon).
+    double best = std::numeric_limits<double>::infinity();
+    const double phi = TrackAnalyzer::deg2rad(lat);
+    for (double edge : { minLon, maxLon }) {
+        best = std::min({ best, meters(minLat, edge), meters(maxLat, edge) });
+        double closest = std::atan2(std::sin(phi), std::cos(phi) * std::cos(TrackAnalyzer::deg2rad(edge - lon))) * 180.0 / M_PI;
+        if (minLat < closest && closest < maxLat) {
+            best = std::min(best, meters(closest, edge));
+        }
+    }
+    return best;
+}
+
+std::vector<std::pair<PointRef, double>> TrackIndex::nearest(double lat, double lon, size_t k) const {
+    std::vector<std::pair<PointRef, double>> res;
+    if (levels.empty() || k == 0) return res;
+    // best-first search; an entry is a node (level, index) or, with level == -1, a point
+    struct Item {
+        double dist;
+        long long level;
+        size_t idx;
+        bool operator>(const Item& o) const { return dist > o.dist; }
+    };
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    TrackPoint center{ lat, lon, 0, 0 };
+    size_t top = levels.size() - 1;
+    heap.push({ boxDistance(lat, lon, levels[top][0]), static_cast<long long>(top), 0 });
+    while (!heap.empty() && res.size() < k) {
+        Item it = heap.top();
+        heap.pop();
+        if (it.level < 0) {
+            res.push_back({ entries[it.idx].ref, it.dist });
+            continue;
+        }
+        size_t lvl = static_cast<size_t>(it.level);
+        if (lvl == 0) {
+            for (size_t i = it.idx * NODE_SIZE; i < std::min(entries.size(), (it.idx + 1) * NODE_SIZE); ++i) {
+                TrackPoint p{ toDeg(entries[i].lat), toDeg(entries[i].lon), 0, 0 };
+                heap.push({ TrackAnalyzer::haversine(center, p) * 1000.0, -1, i });
+            }
+            continue;
+        }
+        for (size_t c = it.idx * NODE_SIZE; c < std::min(levels[lvl - 1].size(), (it.idx + 1) * NODE_SIZE); ++c) {
+            heap.push({ boxDistance(lat, lon, levels[lvl - 1][c]), static_cast<long long>(lvl - 1), c });
+        }
+    }
+    return res;
+}
@@ -0,0 +1,66 @@
+#include "GPS.h"
+
+SplitAggregator::SplitAggregator(std::vector<SplitSpec> sp) : specs(std::move(sp)), done(specs.size()) {
+    for (const SplitSpec& spec : specs) {
+        if (!(spec.width > 0)) {
+            throw std::runtime_error("error: split width must be positive");
+        }
+        open.push_back({ spec.width, 0, 0, 0 });
+    }
+}
+
+void SplitAggregator::close(size_t spec, double dist, double tm, double ele) {
+    Open& o = open[spec];
+    done[spec].push_back({ static_cast<uint32_t>(spec), o.number, o.startDistance, o.startTime,
+        dist - o.startDistance, tm - o.startTime, o.gain, o.loss });
+    ++o.number;
+    o.startDistance = dist;
+    o.startTime = tm;
+    o.startEle = ele;
+    o.gain = o.loss = 0;
+}
+
+void SplitAggregator::add(const TrackPoint& a, const TrackPoint& b) {
+    if (!started) {
+        for (Open& o : open) o.startEle = a.ele;
+        started = true;
+    }
+    double segDist = TrackAnalyzer::haversine(a, b);
+    double segTime = std::max(difftime(b.time, a.time), 0.0);
+    double d0 = distance, t0 = time;
+    distance += segDist;
+    time += segTime;
+
+    for (size_t s = 0; s < specs.size(); ++s) {
+        Open& o = open[s];
+        bool byDistance = specs[s].kind == SplitSpec::Distance;
+        double from = byDistance ? d0 : t0;
+        double to = byDistance ? distance : time;
+        double prevEle = a.ele;
+        while (o.nextBoundary <= to && to > from) {
+            double f = (o.nextBoundary - from) / (to - from);
+            double ele = a.ele + f * (b.ele - a.ele);
+            (ele > prevEle ? o.gain : o.loss) += std::abs(ele - prevEle);
+            prevEle = ele;
+            close(s, d0 + f * segDist, t0 + f * segTime, ele);
+            o.nextBoundary += specs[s].width;
+        }
+        (b.ele > prevEle ? o.gain : o.loss) += std::abs(b.ele - prevEle);
+    }
+}
+
+std::vector<Split> SplitAggregator::finish() const {
+    std::vector<Split> res;
+    size_t total = 0;
+    for (const auto& d : done) total += d.size() + 1;
+    res.reserve(total);
+    for (size_t s = 0; s < specs.size(); ++s) {
+        res.insert(res.end(), done[s].begin(), done[s].end());
+        const Open& o = open[s];
+        if (distance > o.startDistance || time > o.startTime) {
+            res.push_back({ static_cast<uint32_t>(s), o.number, o.startDistance, o.startTime,
+                distance - o.startDistance, time - o.startTime, o.gain, o.loss });
+        }
+    }
+    return res;
+}
@@ -0,0 +1,50 @@
+#include "GPS.h"
+
+StreamingTrackAnalyzer::StreamingTrackAnalyzer(double stopSpeed, int speedBin) : timeDist(stopSpeed, speedBin) {}
+
+void StreamingTrackAnalyzer::setSegmentation(double moveSpeed, double minStopDuration) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (count > 0) {
+        throw std::runtime_error("error: segmentation must be set before the first point");
+    }
+    timeDist.segmenter.emplace(timeDist.stopSpeed, moveSpeed, minStopDuration);
+}
+
+void StreamingTrackAnalyzer::append(const TrackPoint& pt) {
+    if (count > 0) {
+        timeDist.add(TrackAnalyzer::haversine(last, pt), difftime(pt.time, last.time));
+        ele.add(last.ele, pt.ele);
+    }
+    last = pt;
+    ++count;
+}
+
+void StreamingTrackAnalyzer::addPoint(const TrackPoint& pt) {
+    std::lock_guard<std::mutex> lock(mtx);
+    append(pt);
+}
+
+void StreamingTrackAnalyzer::addPoints(const std::vector<TrackPoint>& pts) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const TrackPoint& pt : pts) {
+        append(pt);
+    }
+}
+
+FinalAnalyzis StreamingTrackAnalyzer::snapshot() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (count < 2) {
+        return FinalAnalyzis(std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt);
+    }
+    FinalAnalyzis res = timeDist.result();
+    res.minEle = ele.minEle;
+    res.maxEle = ele.maxEle;
+    res.elevationGain = ele.elevationGain;
+    res.elevationLoss = ele.elevationLoss;
+    return res;
+}
+
+size_t StreamingTrackAnalyzer::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return count;
+}
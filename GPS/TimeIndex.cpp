@@ -0,0 +1,85 @@
+#include "GPS.h"
+
+namespace {
+    TrackPoint interpolate(const TrackPoint& a, const TrackPoint& b, double f, double t) {
+        return { a.lat + f * (b.lat - a.lat), a.lon + f * (b.lon - a.lon), a.ele + f * (b.ele - a.ele),
+            static_cast<std::time_t>(std::llround(t)) };
+    }
+}
+
+TimeIndex::TimeIndex(const std::vector<TrackPoint>& pts) : points(pts) {
+    times.reserve(points.size());
+    for (const TrackPoint& p : points) {
+        if (!times.empty() && p.time < times.back()) {
+            throw std::runtime_error("error: track times go backwards");
+        }
+        times.push_back(static_cast<double>(p.time));
+    }
+}
+
+size_t TimeIndex::segmentAt(double t) const {
+    const size_t n = times.size();
+    if (n < 2 || t <= times.front()) return 0;
+    if (t >= times.back()) return n - 1;
+
+    double span = times.back() - times.front();
+    size_t guess = std::min(static_cast<size_t>((t - times.front()) / span * (n - 1)), n - 2);
+    // Gallop from the guess to a window [lo, hi) with times[lo] <= t < times[hi].
+    size_t lo, hi;
+    if (times[guess] <= t) {
+        lo = guess;
+        size_t step = 1;
+        hi = guess + 1;
+        while (hi < n && times[hi] <= t) {
+            lo = hi;
+            hi = std::min(hi + step, n);
+            step *= 2;
+        }
+    }
+    else {
+        hi = guess;
+        size_t step = 1;
+        lo = guess >= step ? guess - step : 0;
+        while (lo > 0 && times[lo] > t) {
+            hi = lo;
+            step *= 2;
+            lo = lo >= step ? lo - step : 0;
+        }
+    }
+    return std::upper_bound(times.begin() + lo, times.begin() + hi, t) - times.begin() - 1;
+}
+
+std::optional<TrackPoint> TimeIndex::at(double t) const {
+    if (times.empty() || t < times.front() || t > times.back()) return std::nullopt;
+    size_t i = segmentAt(t);
+    if (i + 1 >= times.size() || times[i + 1] == times[i]) return points[i];
+    double f = (t - times[i]) / (times[i + 1] - times[i]);
+    return interpolate(points[i], points[i + 1], f, t);
+}
+
+std::vector<TrackPoint> TimeIndex::resample(double period) const {
+    if (!(period > 0)) {
+        throw std::runtime_error("error: resampling period must be positive");
+    }
+    std::vector<TrackPoint> res;
+    if (times.empty()) return res;
+    const double t0 = times.front();
+    const size_t count = static_cast<size_t>(std::floor((times.back() - t0) / period)) + 1;
+    res.resize(count);
+
+    // Every output sample falls in exactly one segment; walk both in step.
+    size_t k = 0;
+    for (size_t i = 0; i + 1 < times.size() && k < count; ++i) {
+        const TrackPoint& a = points[i];
+        const TrackPoint& b = points[i + 1];
+        const double ta = times[i], dt = times[i + 1] - ta;
+        if (dt <= 0) continue;
+        for (; k < count; ++k) {
+            double t = t0 + k * period;
+            if (t >= times[i + 1]) break;
+            res[k] = interpolate(a, b, (t - ta) / dt, t);
+        }
+    }
+    for (; k < count; ++k) res[k] = points.back();
+    return res;
+}
@@ -0,0 +1,125 @@
+#include "GPS.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+template<class T, class Get>
+void writeColumn(std::ofstream& out, const std::vector<TrackPoint>& points, Get get, double& minV, double& maxV) {
+    std::vector<T> buf;
+    buf.reserve(std::min<size_t>(points.size(), 1 << 16));
+    for (size_t i = 0; i < points.size(); ++i) {
+        T v = static_cast<T>(get(points[i]));
+        if (i == 0 || v < minV) minV = static_cast<double>(v);
+        if (i == 0 || v > maxV) maxV = static_cast<double>(v);
+        buf.push_back(v);
+        if (buf.size() == buf.capacity() || i + 1 == points.size()) {
+            out.write(reinterpret_cast<const char*>(buf.data()), buf.size() * sizeof(T));
+            buf.clear();
+        }
+    }
+}
+}
+
+void GPXParser::saveCache(const std::vector<TrackPoint>& points, const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    TrackCacheHeader header;
+    header.count = points.size();
+    uint64_t columnBytes = points.size() * sizeof(double);
+    for (size_t c = 0; c < TrackCacheHeader::ColumnCount; ++c) {
+        header.offset[c] = sizeof(TrackCacheHeader) + c * columnBytes;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeColumn<double>(out, points, [](const TrackPoint& p) { return p.lat; }, header.minValue[TrackCacheHeader::Lat], header.maxValue[TrackCacheHeader::Lat]);
+    writeColumn<double>(out, points, [](const TrackPoint& p) { return p.lon; }, header.minValue[TrackCacheHeader::Lon], header.maxValue[TrackCacheHeader::Lon]);
+    writeColumn<double>(out, points, [](const TrackPoint& p) { return p.ele; }, header.minValue[TrackCacheHeader::Ele], header.maxValue[TrackCacheHeader::Ele]);
+    writeColumn<int64_t>(out, points, [](const TrackPoint& p) { return p.time; }, header.minValue[TrackCacheHeader::Time], header.maxValue[TrackCacheHeader::Time]);
+    // min/max are only known after the columns went out
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        throw std::runtime_error("error: cant write " + filename);
+    }
+}
+
+
+
+MappedTrack::MappedTrack(const std::string& filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    bytes = static_cast<size_t>(size.QuadPart);
+    HANDLE mapping = bytes ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (mapping) {
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+    }
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    bytes = static_cast<size_t>(st.st_size);
+    if (bytes) {
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        data = p == MAP_FAILED ? nullptr : static_cast<const char*>(p);
+    }
+    close(fd);
+#endif
+    if (!data || bytes < sizeof(TrackCacheHeader) || header().magic != TrackCacheHeader::MAGIC
+        || header().version != TrackCacheHeader::VERSION) {
+        unmap();
+        throw std::runtime_error("error: bad track cache " + filename);
+    }
+    count = header().count;
+    for (size_t c = 0; c < TrackCacheHeader::ColumnCount; ++c) {
+        uint64_t off = header().offset[c];
+        if (off % 8 != 0 || off > bytes || (bytes - off) / 8 < count) {
+            unmap();
+            throw std::runtime_error("error: bad track cache " + filename);
+        }
+    }
+    lat = reinterpret_cast<const double*>(data + header().offset[TrackCacheHeader::Lat]);
+    lon = reinterpret_cast<const double*>(data + header().offset[TrackCacheHeader::Lon]);
+    ele = reinterpret_cast<const double*>(data + header().offset[TrackCacheHeader::Ele]);
+    time = reinterpret_cast<const int64_t*>(data + header().offset[TrackCacheHeader::Time]);
+}
+
+MappedTrack::~MappedTrack() {
+    unmap();
+}
+
+void MappedTrack::unmap() {
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), bytes);
+#endif
+    data = nullptr;
+}
+
+std::vector<TrackPoint> MappedTrack::toPoints() const {
+    std::vector<TrackPoint> points(count);
+    for (size_t i = 0; i < count; ++i) {
+        points[i] = (*this)[i];
+    }
+    return points;
+}
@@ -1,14 +1,68 @@
 #include "GPS.h"
 
-int main() {
-    std::string gpxFile = "input.gpx";
-    std::string outFile = "analysis.txt";
-    auto points = GPXParser::parse(gpxFile);
-    EleAnalyzer* analyzer = new EleAnalyzer(points);
-    TimeDistAnalyzer* analyzer2 = new TimeDistAnalyzer(points);
-    AnalysisSaver f;
-    f.adddAnalyzer(analyzer);
-    f.adddAnalyzer(analyzer2);
-    f.saveAnalysis(outFile);
-    return 0;
-}
\ No newline at end of file
+namespace {
+    void printUsage() {
+        std::cerr << "usage: GPS                                   analyze input.gpx into analysis.txt\n"
+            << "       GPS --batch [--cache] <dir|file.gpx|list> [report] [summary]\n"
+            << "       GPS --bench [points...]\n"
+            << "       GPS --bench-metrics [file.gpx]\n";
+    }
+
+    int runBatch(int argc, char* argv[]) {
+        std::vector<std::string> args;
+        bool cache = false;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--cache") cache = true;
+            else args.push_back(argv[i]);
+        }
+        if (args.empty()) {
+            printUsage();
+            return 2;
+        }
+        std::string reportFile = args.size() > 1 ? args[1] : "report.txt";
+        std::string summaryFile = args.size() > 2 ? args[2] : "summary.csv";
+        BatchProcessor batch;
+        batch.setCache(cache);
+        BatchStats stats = batch.run(BatchProcessor::collectInputs(args[0]), reportFile, summaryFile);
+        std::cout << stats.files << " files, " << stats.filesPerSecond() << " files/s, "
+            << stats.pointsPerSecond() << " points/s" << std::endl;
+        return stats.failed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc >= 2 && std::string(argv[1]) == "--batch") {
+            return runBatch(argc, argv);
+        }
+        if (argc >= 2 && std::string(argv[1]) == "--bench") {
+            std::vector<size_t> sizes;
+            for (int i = 2; i < argc; ++i) sizes.push_back(std::stoull(argv[i]));
+            if (sizes.empty()) sizes = { 1000, 1000000 };
+            benchmarkPipeline(std::cout, sizes);
+            return 0;
+        }
+        if (argc >= 2 && std::string(argv[1]) == "--bench-metrics") {
+            benchmarkDistanceMetrics(std::cout, GPXParser::parse(argc > 2 ? argv[2] : "input.gpx"));
+            return 0;
+        }
+        if (argc >= 2) {
+            printUsage();
+            return 2;
+        }
+        std::string gpxFile = "input.gpx";
+        std::string outFile = "analysis.txt";
+        auto points = GPXParser::parse(gpxFile);
+        EleAnalyzer* analyzer = new EleAnalyzer(points);
+        TimeDistAnalyzer* analyzer2 = new TimeDistAnalyzer(points);
+        AnalysisSaver f;
+        f.adddAnalyzer(analyzer);
+        f.adddAnalyzer(analyzer2);
+        f.saveAnalysis(outFile);
+        return 0;
+    }
+    catch (std::exception& a) {
+        std::cerr << a.what() << std::endl;
+        return 1;
+    }
+}
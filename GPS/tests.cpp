@@ -0,0 +1,691 @@
+#include "GPS.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+class GPSTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+    }
+
+    static std::vector<TrackPoint> makeTrack(size_t points, uint64_t seed = 1) {
+        SyntheticTrackOptions opt;
+        opt.points = points;
+        opt.seed = seed;
+        opt.stopRate = 0.002;
+        return TrackGenerator::generate(opt);
+    }
+
+    static void expectSame(const FinalAnalyzis& a, const FinalAnalyzis& b) {
+        auto near = [](const std::optional<double>& x, const std::optional<double>& y) {
+            ASSERT_EQ(x.has_value(), y.has_value());
+            if (x) {
+                EXPECT_NEAR(*x, *y, 1e-9 * std::max(1.0, std::abs(*y)));
+            }
+        };
+        near(a.totalDistance, b.totalDistance);
+        near(a.totalTime, b.totalTime);
+        near(a.movingTime, b.movingTime);
+        near(a.maxSpeed, b.maxSpeed);
+        near(a.avgSpeed, b.avgSpeed);
+        near(a.avgMovingSpeed, b.avgMovingSpeed);
+        near(a.minEle, b.minEle);
+        near(a.maxEle, b.maxEle);
+        near(a.elevationGain, b.elevationGain);
+        near(a.elevationLoss, b.elevationLoss);
+        ASSERT_EQ(a.speedDistribution.has_value(), b.speedDistribution.has_value());
+        if (a.speedDistribution) {
+            ASSERT_EQ(a.speedDistribution->binCount(), b.speedDistribution->binCount());
+            for (size_t i = 0; i < a.speedDistribution->binCount(); ++i) {
+                EXPECT_NEAR((*a.speedDistribution)[i], (*b.speedDistribution)[i], 1e-6);
+            }
+        }
+    }
+
+    static std::string readFile(const std::string& file) {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    static double meters(double lat1, double lon1, double lat2, double lon2) {
+        return HaversineMetric::distance({ lat1, lon1, 0, 0 }, { lat2, lon2, 0, 0 }) * 1000;
+    }
+};
+
+TEST_F(GPSTest, MetricsAcrossAntimeridian) {
+    TrackPoint west{ 10, 179.99999, 0, 0 }, east{ 10, -179.99999, 0, 0 };
+    double expected = HaversineMetric::distance(west, east);
+    EXPECT_LT(expected, 0.01);
+    EXPECT_NEAR(EquirectangularMetric::distance(west, east), expected, 1e-9);
+    EXPECT_NEAR(EquirectangularMetric::distance(east, west), expected, 1e-9);
+    EXPECT_NEAR(VincentyMetric::distance(west, east), expected, 1e-4);
+}
+
+TEST_F(GPSTest, ChunkedAnalyzersMatchSequential) {
+    auto pts = makeTrack(5000);
+    ThreadPool pool(3);
+
+    TimeDistAnalyzer seqTd(pts), parTd(pts);
+    parTd.setThreadPool(&pool, 300);
+    expectSame(parTd.Analyze(1.0, 5), seqTd.Analyze(1.0, 5));
+
+    EleAnalyzer seqEle(pts), parEle(pts);
+    parEle.setThreadPool(&pool, 300);
+    expectSame(parEle.Analyze(), seqEle.Analyze());
+
+    seqEle.setFilter(ElevationFilter::median(5));
+    parEle.setFilter(ElevationFilter::median(5));
+    expectSame(parEle.Analyze(), seqEle.Analyze());
+}
+
+TEST_F(GPSTest, ElevationFilters) {
+    auto run = [](ElevationFilter f, const std::vector<double>& input) {
+        std::vector<double> out;
+        for (double ele : input) out.push_back(f.push(ele));
+        return out;
+    };
+    auto expectNear = [](const std::vector<double>& got, const std::vector<double>& want) {
+        ASSERT_EQ(got.size(), want.size());
+        for (size_t i = 0; i < want.size(); ++i) {
+            EXPECT_NEAR(got[i], want[i], 1e-12) << "at " << i;
+        }
+    };
+    expectNear(run(ElevationFilter::movingAverage(3), { 1, 2, 3, 10, 4 }), { 1, 1.5, 2, 5, 17.0 / 3 });
+    expectNear(run(ElevationFilter::median(3), { 5, 1, 9, 2, 7, 3 }), { 5, 3, 5, 2, 7, 3 });
+    expectNear(run(ElevationFilter::median(4), { 4, 8, 1, 6, 2 }), { 4, 6, 4, 5, 4 });
+    // q = r = 1: the gains are 2/3 and then 5/8.
+    expectNear(run(ElevationFilter::kalman(1, 1), { 10, 20, 20 }), { 10, 50.0 / 3, 18.75 });
+
+    EXPECT_THROW(ElevationFilter::movingAverage(0), std::runtime_error);
+    EXPECT_THROW(ElevationFilter::kalman(0, 0), std::runtime_error);
+
+    // After a long run of large readings, the average of the last window is exact.
+    ElevationFilter avg = ElevationFilter::movingAverage(4);
+    for (int i = 0; i < 100001; ++i) avg.push(1e10 * (i % 7) + 0.1 * i);
+    double last = 0;
+    for (double ele : { 1.0, 2.0, 3.0, 4.0 }) last = avg.push(ele);
+    EXPECT_DOUBLE_EQ(last, 2.5);
+    avg.reset();
+    EXPECT_EQ(avg.push(7), 7);
+}
+
+TEST_F(GPSTest, ChunkedFiltersMatchSequential) {
+    auto pts = makeTrack(5000, 4);
+    ThreadPool pool(3);
+    for (const ElevationFilter& f : { ElevationFilter::movingAverage(7), ElevationFilter::median(5), ElevationFilter::kalman() }) {
+        EleAnalyzer seq(pts), par(pts);
+        par.setThreadPool(&pool, 300);
+        seq.setFilter(f);
+        par.setFilter(f);
+        expectSame(par.Analyze(), seq.Analyze());
+    }
+}
+
+TEST_F(GPSTest, ChunkedAnalyzerInsidePoolTask) {
+    auto pts = makeTrack(5000);
+    ThreadPool pool(1);
+    TimeDistAnalyzer td(pts);
+    td.setThreadPool(&pool, 300);
+    // The only worker runs the outer task, so the chunks must run on it too.
+    auto outer = pool.submit([&td] { return td.Analyze(); });
+    ASSERT_EQ(outer.wait_for(std::chrono::seconds(20)), std::future_status::ready);
+    expectSame(outer.get(), TimeDistAnalyzer(pts).Analyze());
+}
+
+TEST_F(GPSTest, StreamingMatchesBatch) {
+    auto pts = makeTrack(2000, 3);
+    StreamingTrackAnalyzer live;
+    live.addPoint(pts[0]);
+    EXPECT_FALSE(live.snapshot().totalDistance.has_value());
+    // Segmentation cannot be switched on once points have been counted without it.
+    EXPECT_THROW(live.setSegmentation(2.0, 30), std::runtime_error);
+
+    // A snapshot mid-feed covers exactly the points added so far.
+    std::vector<TrackPoint> head(pts.begin(), pts.begin() + 1000);
+    live.addPoints(std::vector<TrackPoint>(pts.begin() + 1, pts.begin() + 1000));
+    ASSERT_EQ(live.size(), 1000);
+    EXPECT_NEAR(*live.snapshot().totalDistance, *TimeDistAnalyzer(head).Analyze().totalDistance, 1e-9);
+
+    live.addPoints(std::vector<TrackPoint>(pts.begin() + 1000, pts.end()));
+    FinalAnalyzis snap = live.snapshot();
+    FinalAnalyzis td = TimeDistAnalyzer(pts).Analyze();
+    EXPECT_NEAR(*snap.totalDistance, *td.totalDistance, 1e-9);
+    EXPECT_NEAR(*snap.totalTime, *td.totalTime, 1e-9);
+    EXPECT_NEAR(*snap.movingTime, *td.movingTime, 1e-9);
+    EXPECT_NEAR(*snap.maxSpeed, *td.maxSpeed, 1e-9);
+    EXPECT_TRUE(*snap.speedDistribution == *td.speedDistribution);
+    FinalAnalyzis el = EleAnalyzer(pts).Analyze();
+    EXPECT_NEAR(*snap.elevationGain, *el.elevationGain, 1e-9);
+    EXPECT_NEAR(*snap.elevationLoss, *el.elevationLoss, 1e-9);
+    EXPECT_NEAR(*snap.minEle, *el.minEle, 1e-9);
+}
+
+TEST_F(GPSTest, ParallelSimplifyInsidePoolTask) {
+    auto pts = makeTrack(20000, 4);
+    auto expected = TrackSimplifier::douglasPeucker(pts, 5);
+    ThreadPool pool(1);
+    auto outer = pool.submit([&pts, &pool] { return TrackSimplifier::douglasPeucker(pts, 5, &pool, 256); });
+    ASSERT_EQ(outer.wait_for(std::chrono::seconds(20)), std::future_status::ready);
+    auto res = outer.get();
+    ASSERT_EQ(res.size(), expected.size());
+    for (size_t i = 0; i < res.size(); ++i) {
+        EXPECT_EQ(res[i].time, expected[i].time);
+    }
+    EXPECT_LT(res.size(), pts.size() / 2);
+}
+
+TEST_F(GPSTest, VisvalingamSimplify) {
+    // Points along the equator, ~111 m apart; time tells them apart after simplifying.
+    auto line = [](size_t n) {
+        std::vector<TrackPoint> pts;
+        for (size_t i = 0; i < n; ++i) pts.push_back({ 0, 0.001 * i, 0, static_cast<time_t>(i) });
+        return pts;
+    };
+    auto times = [](const std::vector<TrackPoint>& pts) {
+        std::vector<time_t> res;
+        for (const auto& p : pts) res.push_back(p.time);
+        return res;
+    };
+
+    // A collinear run has zero areas and collapses to its endpoints.
+    EXPECT_EQ(times(TrackSimplifier::visvalingam(line(11), 1)), (std::vector<time_t>{ 0, 10 }));
+
+    // A tent whose apex triangle is far above tolerance^2 keeps the apex, the
+    // straight flanks around it go.
+    auto spiked = line(11);
+    for (size_t i = 0; i < spiked.size(); ++i) spiked[i].lat = 0.0002 * std::min<size_t>(i, 10 - i);
+    EXPECT_EQ(times(TrackSimplifier::visvalingam(spiked, 10)), (std::vector<time_t>{ 0, 5, 10 }));
+
+    // The tolerance is a length: a triangle is kept only if its area reaches tolerance^2.
+    auto three = line(3);
+    double base = meters(0, 0, 0, 0.002);
+    auto withArea = [&](double area) {
+        auto pts = three;
+        pts[1].lat = 2 * area / base / meters(0, 0, 1, 0);
+        return times(TrackSimplifier::visvalingam(pts, 10)).size();
+    };
+    EXPECT_EQ(withArea(200), 3);
+    EXPECT_EQ(withArea(50), 2);
+    EXPECT_EQ(withArea(20), 2);
+
+    // The first and last points always survive, whatever the tolerance.
+    auto kept = TrackSimplifier::visvalingam(spiked, 1e6);
+    ASSERT_EQ(kept.size(), 2);
+    EXPECT_EQ(kept.front().time, 0);
+    EXPECT_EQ(kept.back().time, 10);
+    EXPECT_EQ(TrackSimplifier::visvalingam(line(2), 1e6).size(), 2);
+}
+
+TEST_F(GPSTest, TrackIndexMatchesBruteForce) {
+    std::vector<std::vector<TrackPoint>> tracks = { makeTrack(3000, 1), makeTrack(2000, 2), makeTrack(500, 3) };
+    TrackIndex index(tracks);
+    ASSERT_EQ(index.size(), 5500);
+
+    auto sorted = [](std::vector<PointRef> v) {
+        std::vector<std::pair<uint32_t, uint32_t>> res;
+        for (const PointRef& r : v) res.push_back({ r.track, r.index });
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+    const TrackPoint& c = tracks[0][1500];
+    std::vector<PointRef> expected;
+    for (uint32_t t = 0; t < tracks.size(); ++t) {
+        for (uint32_t i = 0; i < tracks[t].size(); ++i) {
+            if (meters(c.lat, c.lon, tracks[t][i].lat, tracks[t][i].lon) <= 400) expected.push_back({ t, i });
+        }
+    }
+    EXPECT_EQ(sorted(index.inRadius(c.lat, c.lon, 400)), sorted(expected));
+
+    double qLat = c.lat + 0.003, qLon = c.lon - 0.002;
+    std::vector<double> all;
+    for (const auto& tr : tracks) {
+        for (const TrackPoint& p : tr) all.push_back(meters(qLat, qLon, p.lat, p.lon));
+    }
+    std::sort(all.begin(), all.end());
+    auto near = index.nearest(qLat, qLon, 10);
+    ASSERT_EQ(near.size(), 10);
+    for (size_t i = 0; i < near.size(); ++i) {
+        EXPECT_NEAR(near[i].second, all[i], 0.05);
+    }
+
+    double minLat = c.lat - 0.01, maxLat = c.lat + 0.02, minLon = c.lon - 0.015, maxLon = c.lon + 0.005;
+    std::vector<PointRef> boxed;
+    std::vector<uint32_t> boxedTracks;
+    for (uint32_t t = 0; t < tracks.size(); ++t) {
+        for (uint32_t i = 0; i < tracks[t].size(); ++i) {
+            const TrackPoint& p = tracks[t][i];
+            if (p.lat >= minLat && p.lat <= maxLat && p.lon >= minLon && p.lon <= maxLon) {
+                boxed.push_back({ t, i });
+                if (boxedTracks.empty() || boxedTracks.back() != t) boxedTracks.push_back(t);
+            }
+        }
+    }
+    EXPECT_EQ(sorted(index.inBox(minLat, minLon, maxLat, maxLon)), sorted(boxed));
+    EXPECT_EQ(index.tracksInBox(minLat, minLon, maxLat, maxLon), boxedTracks);
+
+    EXPECT_EQ(index.nearest(qLat, qLon, 10000).size(), index.size());
+    TrackIndex empty(std::vector<std::vector<TrackPoint>>{});
+    EXPECT_TRUE(empty.nearest(qLat, qLon, 3).empty());
+    EXPECT_TRUE(empty.inRadius(qLat, qLon, 1000).empty());
+}
+
+TEST_F(GPSTest, TrackIndexMatchesBruteForceGlobally) {
+    // A track along lon 90 from the equator to lat 80, plus scattered points all over the globe.
+    std::vector<std::vector<TrackPoint>> tracks(2);
+    for (int i = 0; i <= 800; ++i) tracks[0].push_back({ i * 0.1, 90, 0, i });
+    uint64_t state = 12345;
+    auto uniform = [&state](double lo, double hi) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return lo + (hi - lo) * static_cast<double>(state >> 11) / 9007199254740992.0;
+    };
+    for (int i = 0; i < 3000; ++i) tracks[1].push_back({ uniform(-89.9, 89.9), uniform(-180, 180), 0, i });
+    tracks[1].push_back({ 70, 170, 0, 0 });
+    tracks[1].push_back({ 10, -179.99, 0, 0 });
+    tracks[1].push_back({ 28, 0, 0, 0 });
+    TrackIndex index(tracks);
+
+    auto brute = [&](double lat, double lon) {
+        std::vector<double> d;
+        for (const auto& tr : tracks) {
+            for (const TrackPoint& p : tr) d.push_back(meters(lat, lon, p.lat, p.lon));
+        }
+        std::sort(d.begin(), d.end());
+        return d;
+    };
+    std::vector<std::pair<double, double>> queries = { { 60, 0 }, { 70, 170 }, { 10, 179.99 }, { 89, 45 }, { -88, -170 } };
+    for (int i = 0; i < 40; ++i) queries.push_back({ uniform(-89, 89), uniform(-180, 180) });
+    for (auto [lat, lon] : queries) {
+        auto expected = brute(lat, lon);
+        auto near = index.nearest(lat, lon, 5);
+        ASSERT_EQ(near.size(), 5);
+        for (size_t i = 0; i < near.size(); ++i) {
+            EXPECT_NEAR(near[i].second, expected[i], 1.0) << lat << "," << lon;
+        }
+        for (double radius : { 50e3, 800e3, 3e6 }) {
+            size_t inside = std::upper_bound(expected.begin(), expected.end(), radius) - expected.begin();
+            EXPECT_EQ(index.inRadius(lat, lon, radius).size(), inside) << lat << "," << lon << " r=" << radius;
+        }
+    }
+}
+
+TEST_F(GPSTest, SpeedHistogramPercentiles) {
+    SpeedHistogram empty(5);
+    EXPECT_EQ(empty.percentile(0.5), 0);
+    empty.add(12, 0);
+    EXPECT_EQ(empty.percentile(0.9), 0);
+
+    // 10 s in [0, 5) km/h and 30 s in [10, 15) km/h
+    SpeedHistogram hist(5);
+    hist.add(2, 10);
+    hist.add(12, 30);
+    EXPECT_NEAR(hist.totalTime(), 40, 1e-12);
+    EXPECT_NEAR(hist.percentile(0), 0, 1e-12);
+    EXPECT_NEAR(hist.percentile(0.25), 5, 1e-12);
+    EXPECT_NEAR(hist.percentile(0.5), 10 + 5.0 / 3, 1e-12);
+    EXPECT_NEAR(hist.percentile(0.9), 10 + 5 * 26.0 / 30, 1e-12);
+    EXPECT_NEAR(hist.percentile(1), 15, 1e-12);
+    EXPECT_NEAR(hist.percentile(7), 15, 1e-12);
+
+    // A glitch far past the last bin lands in it instead of growing the array.
+    SpeedHistogram glitch(5);
+    glitch.add(1e9, 1);
+    EXPECT_EQ(glitch.binCount(), SpeedHistogram::MAX_BINS);
+    EXPECT_EQ(glitch[SpeedHistogram::MAX_BINS - 1], 1);
+    EXPECT_NEAR(glitch.percentile(1), SpeedHistogram::MAX_BINS * 5.0, 1e-9);
+
+    hist.merge(glitch);
+    EXPECT_NEAR(hist.totalTime(), 41, 1e-12);
+    EXPECT_EQ(hist[2], 30);
+    EXPECT_THROW(hist.merge(SpeedHistogram(10)), std::runtime_error);
+}
+
+TEST_F(GPSTest, CacheRoundTrip) {
+    auto pts = makeTrack(1000);
+    GPXParser::saveCache(pts, "test.trk");
+    {
+        MappedTrack mapped("test.trk");
+        ASSERT_EQ(mapped.size(), pts.size());
+        auto back = mapped.toPoints();
+        for (size_t i = 0; i < pts.size(); ++i) {
+            EXPECT_EQ(back[i].lat, pts[i].lat);
+            EXPECT_EQ(back[i].lon, pts[i].lon);
+            EXPECT_EQ(back[i].ele, pts[i].ele);
+            EXPECT_EQ(back[i].time, pts[i].time);
+        }
+        EXPECT_EQ(mapped[999].time, pts[999].time);
+    }
+
+    // A cache cut short or with a foreign header is rejected, not mapped.
+    std::string data = readFile("test.trk");
+    std::ofstream("test_cut.trk", std::ios::binary) << data.substr(0, data.size() - 8);
+    EXPECT_THROW(MappedTrack("test_cut.trk"), std::runtime_error);
+    data[0] ^= 0xFF;
+    std::ofstream("test_cut.trk", std::ios::binary) << data;
+    EXPECT_THROW(MappedTrack("test_cut.trk"), std::runtime_error);
+
+    std::remove("test.trk");
+    std::remove("test_cut.trk");
+    EXPECT_THROW(MappedTrack("test.trk"), std::runtime_error);
+}
+
+TEST_F(GPSTest, CompressedRoundTrip) {
+    auto pts = makeTrack(1000);
+    CompressedTrack packed(pts);
+    ASSERT_EQ(packed.size(), pts.size());
+    EXPECT_LT(packed.memoryBytes(), pts.size() * sizeof(TrackPoint) / 3);
+    auto back = packed.toPoints();
+    for (size_t i = 0; i < pts.size(); i += 37) {
+        EXPECT_NEAR(back[i].lat, pts[i].lat, 1e-6);
+        EXPECT_NEAR(back[i].lon, pts[i].lon, 1e-6);
+        EXPECT_NEAR(back[i].ele, pts[i].ele, 0.1);
+        EXPECT_EQ(back[i].time, pts[i].time);
+        EXPECT_EQ(packed[i].time, pts[i].time);
+    }
+
+    // Appending point by point gives the same blocks, and a cursor can start
+    // anywhere, including right at and just past a block boundary.
+    CompressedTrack appended;
+    for (const TrackPoint& p : pts) appended.append(p);
+    appended.shrinkToFit();
+    ASSERT_EQ(appended.blockCount(), (pts.size() + CompressedTrack::BLOCK_SIZE - 1) / CompressedTrack::BLOCK_SIZE);
+    EXPECT_EQ(appended.memoryBytes(), packed.memoryBytes());
+    for (size_t start : { size_t(0), CompressedTrack::BLOCK_SIZE - 1, CompressedTrack::BLOCK_SIZE, size_t(700) }) {
+        CompressedTrack::Cursor cur(appended, start);
+        for (size_t i = start; i < std::min(start + 300, pts.size()); ++i) {
+            TrackPoint p = cur.next();
+            ASSERT_EQ(p.time, back[i].time) << start << " " << i;
+            ASSERT_EQ(p.lat, back[i].lat);
+            ASSERT_EQ(p.ele, back[i].ele);
+        }
+    }
+}
+
+TEST_F(GPSTest, StopMoveSegmentation) {
+    // 36 km/h, 0 km/h, 36 km/h; the stop lasts 5 or 9 segments of 10 s
+    auto run = [](size_t stopSegments) {
+        StopMoveSegmenter seg(1.0, 3.0, 60);
+        for (int i = 0; i < 10; ++i) seg.add(0.1, 10);
+        for (size_t i = 0; i < stopSegments; ++i) seg.add(0.0, 10);
+        for (int i = 0; i < 10; ++i) seg.add(0.1, 10);
+        return seg.intervals();
+    };
+    auto shortStop = run(5);
+    ASSERT_EQ(shortStop.size(), 1);
+    EXPECT_TRUE(shortStop[0].moving);
+    EXPECT_EQ(shortStop[0].end, 25);
+
+    auto longStop = run(9);
+    ASSERT_EQ(longStop.size(), 3);
+    EXPECT_FALSE(longStop[1].moving);
+    EXPECT_EQ(longStop[1].begin, 10);
+    EXPECT_EQ(longStop[1].end, 19);
+    EXPECT_NEAR(longStop[1].duration, 90, 1e-9);
+    EXPECT_EQ(longStop[2].begin, 19);
+    EXPECT_NEAR(longStop[0].distance + longStop[2].distance, 2.0, 1e-9);
+
+    // one 10 min gap between fixes is a stop on its own
+    StopMoveSegmenter seg(1.0, 3.0, 60);
+    seg.add(0.1, 10);
+    seg.add(0.0, 600);
+    seg.add(0.1, 10);
+    auto single = seg.intervals();
+    ASSERT_EQ(single.size(), 3);
+    EXPECT_TRUE(single[0].moving);
+    EXPECT_FALSE(single[1].moving);
+    EXPECT_EQ(single[1].begin, 1);
+    EXPECT_EQ(single[1].end, 2);
+    EXPECT_NEAR(single[1].duration, 600, 1e-9);
+    EXPECT_TRUE(single[2].moving);
+
+    // Between stopSpeed and moveSpeed a stop goes on: 2 km/h keeps it open.
+    StopMoveSegmenter hyst(1.0, 3.0, 60);
+    hyst.add(0.1, 10);
+    hyst.add(0.0, 100);
+    hyst.add(2.0 * 10 / 3600, 10);
+    hyst.add(0.1, 10);
+    auto held = hyst.intervals();
+    ASSERT_EQ(held.size(), 3);
+    EXPECT_EQ(held[1].begin, 1);
+    EXPECT_EQ(held[1].end, 3);
+    EXPECT_NEAR(held[1].duration, 110, 1e-9);
+
+    // A candidate still open at the end is reported as movement, and a segment
+    // without time joins whatever is open.
+    StopMoveSegmenter open(1.0, 3.0, 60);
+    open.add(0.1, 10);
+    open.add(0.05, 0);
+    open.add(0.0, 10);
+    auto tail = open.intervals();
+    ASSERT_EQ(tail.size(), 1);
+    EXPECT_TRUE(tail[0].moving);
+    EXPECT_EQ(tail[0].end, 3);
+    EXPECT_NEAR(tail[0].duration, 20, 1e-9);
+    EXPECT_NEAR(tail[0].distance, 0.15, 1e-9);
+}
+
+TEST_F(GPSTest, Splits) {
+    // 0.5 km every 100 s, climbing 10 m per segment
+    std::vector<TrackPoint> pts;
+    for (int i = 0; i <= 5; ++i) {
+        pts.push_back({ 0, i * 0.5 / 111.19492664455873, i * 10.0, i * 100 });
+    }
+    auto splits = SplitAggregator::compute(pts, { { SplitSpec::Distance, 1.0 }, { SplitSpec::Time, 120 } });
+    std::vector<Split> km, time;
+    for (const Split& s : splits) (s.spec == 0 ? km : time).push_back(s);
+
+    ASSERT_EQ(km.size(), 3);
+    EXPECT_NEAR(km[0].distance, 1.0, 1e-6);
+    EXPECT_NEAR(km[0].duration, 200, 1e-3);
+    EXPECT_NEAR(km[0].elevationGain, 20, 1e-3);
+    EXPECT_NEAR(km[2].distance, 0.5, 1e-6);
+    EXPECT_EQ(km[2].number, 2);
+    EXPECT_NEAR(km[1].startDistance, 1.0, 1e-6);
+    EXPECT_NEAR(km[1].startTime, 200, 1e-3);
+
+    ASSERT_EQ(time.size(), 5);
+    EXPECT_NEAR(time[4].duration, 20, 1e-6);
+    double total = 0;
+    for (const Split& s : time) total += s.distance;
+    EXPECT_NEAR(total, 2.5, 1e-6);
+    EXPECT_THROW(SplitAggregator({ { SplitSpec::Time, 0 } }), std::runtime_error);
+
+    // Up 10 m and back down over exactly 1 km: one full split and no empty partial one.
+    std::vector<TrackPoint> hill = { { 0, 0, 0, 0 }, { 0, 0.5 / 111.19492664455873, 10, 100 }, { 0, 1.0 / 111.19492664455873, 0, 200 } };
+    auto lap = SplitAggregator::compute(hill, { { SplitSpec::Distance, 1.0 } });
+    ASSERT_EQ(lap.size(), 1);
+    EXPECT_NEAR(lap[0].elevationGain, 10, 1e-6);
+    EXPECT_NEAR(lap[0].elevationLoss, 10, 1e-6);
+    EXPECT_TRUE(SplitAggregator::compute(std::vector<TrackPoint>{ hill[0] }, { { SplitSpec::Distance, 1.0 } }).empty());
+}
+
+TEST_F(GPSTest, TimeIndexAndResampling) {
+    std::vector<TrackPoint> pts = { { 0, 0, 0, 100 }, { 0, 0, 0, 100 }, { 1, 2, 10, 110 }, { 1, 2, 10, 130 }, { 3, 2, 30, 131 } };
+    TimeIndex index(pts);
+    EXPECT_EQ(index.segmentAt(50), 0);
+    EXPECT_EQ(index.segmentAt(100), 0);
+    EXPECT_EQ(index.segmentAt(109.5), 1);
+    EXPECT_EQ(index.segmentAt(130), 3);
+    EXPECT_EQ(index.segmentAt(500), 4);
+    EXPECT_FALSE(index.at(99).has_value());
+    EXPECT_FALSE(index.at(131.5).has_value());
+    EXPECT_NEAR(index.at(105)->lat, 0.5, 1e-12);
+    EXPECT_NEAR(index.at(120)->lon, 2, 1e-12);
+
+    auto res = index.resample(10);
+    ASSERT_EQ(res.size(), 4);
+    EXPECT_EQ(res[0].time, 100);
+    EXPECT_NEAR(res[1].ele, 10, 1e-12);
+    EXPECT_EQ(res[3].time, 130);
+    EXPECT_EQ(index.resample(100).size(), 1);
+    EXPECT_THROW(index.resample(0), std::runtime_error);
+
+    std::vector<TrackPoint> backwards = { { 0, 0, 0, 10 }, { 0, 0, 0, 5 } };
+    EXPECT_THROW(TimeIndex{ backwards }, std::runtime_error);
+
+    // Uneven sampling with long gaps: the galloping search agrees with a binary search.
+    std::vector<TrackPoint> uneven;
+    std::time_t t = 1000;
+    for (int i = 0; i < 5000; ++i) {
+        uneven.push_back({ 0, 0, 0, t });
+        t += i % 97 == 0 ? 3600 : i % 3;
+    }
+    TimeIndex gallop(uneven);
+    for (double q = 900; q < t + 100; q += 37.25) {
+        auto it = std::upper_bound(uneven.begin(), uneven.end(), q, [](double v, const TrackPoint& p) { return v < p.time; });
+        size_t expected = it == uneven.begin() ? 0 : static_cast<size_t>(it - uneven.begin()) - 1;
+        ASSERT_EQ(gallop.segmentAt(q), expected) << q;
+    }
+}
+
+TEST_F(GPSTest, DedupFindsContainedTrack) {
+    MinHasher hasher;
+    LshIndex index;
+    auto ride = makeTrack(4000, 3);
+    std::vector<TrackPoint> prefix(ride.begin(), ride.begin() + 500);
+    uint32_t full = index.add(hasher.fingerprint(ride));
+    index.add(hasher.fingerprint(makeTrack(4000, 4)));
+    uint32_t part = index.add(hasher.fingerprint(prefix));
+
+    TrackMatch exact = LshIndex::compare(full, index[full], part, index[part]);
+    EXPECT_LT(exact.jaccard, 0.3);
+    EXPECT_GE(exact.containment, 0.85);
+
+    auto matches = index.findSimilar();
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0].a, full);
+    EXPECT_EQ(matches[0].b, part);
+    auto cands = index.candidates(index[part]);
+    EXPECT_TRUE(std::find(cands.begin(), cands.end(), full) != cands.end());
+}
+
+class RecordWriterTest : public GPSTest {
+protected:
+    // One record with a speed histogram and some fields absent, one failed track.
+    static void writeRecords(const std::string& file, RecordWriter::Format format) {
+        SpeedHistogram hist(5);
+        hist.add(12, 30);
+        FinalAnalyzis td(12.5, 3600, std::nullopt, std::nullopt, std::nullopt, std::nullopt, hist,
+            std::nullopt, std::nullopt, std::nullopt, std::nullopt);
+        FinalAnalyzis el(std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+            -3.25, std::nullopt, std::nullopt, std::nullopt);
+        RecordWriter writer(file, format);
+        writer.write(NAME, 7, { td, el });
+        writer.write("bad.gpx", 0, {}, "stod\tfail");
+        writer.flush();
+    }
+
+    static constexpr std::string_view NAME{ "a;\"b\\c\n\x01" };
+};
+
+TEST_F(RecordWriterTest, Csv) {
+    writeRecords("records.csv", RecordWriter::Csv);
+    EXPECT_EQ(readFile("records.csv"),
+        "name;points;min_ele;max_ele;ele_gain;ele_loss;total_time;distance;avg_speed;moving_time;avg_moving_speed;max_speed;error\n"
+        "\"a;\"\"b\\c\n\x01\";7;-3.25;;;;3600;12.5;;;;;\n"
+        "bad.gpx;0;;;;;;;;;;;stod\tfail\n");
+    std::remove("records.csv");
+}
+
+TEST_F(RecordWriterTest, JsonLines) {
+    writeRecords("records.jsonl", RecordWriter::JsonLines);
+    EXPECT_EQ(readFile("records.jsonl"),
+        "{\"name\":\"a;\\\"b\\\\c\\n\\u0001\",\"points\":7,\"min_ele\":-3.25,\"max_ele\":null,\"ele_gain\":null,"
+        "\"ele_loss\":null,\"total_time\":3600,\"distance\":12.5,\"avg_speed\":null,\"moving_time\":null,"
+        "\"avg_moving_speed\":null,\"max_speed\":null,\"speed_histogram\":{\"width\":5,\"bins\":[[10,30]]}}\n"
+        "{\"name\":\"bad.gpx\",\"points\":0,\"min_ele\":null,\"max_ele\":null,\"ele_gain\":null,"
+        "\"ele_loss\":null,\"total_time\":null,\"distance\":null,\"avg_speed\":null,\"moving_time\":null,"
+        "\"avg_moving_speed\":null,\"max_speed\":null,\"error\":\"stod\\tfail\"}\n");
+    std::remove("records.jsonl");
+}
+
+TEST_F(RecordWriterTest, Binary) {
+    writeRecords("records.bin", RecordWriter::Binary);
+    std::string data = readFile("records.bin");
+    size_t pos = 0;
+    auto take = [&](auto& v) {
+        ASSERT_LE(pos + sizeof(v), data.size());
+        std::memcpy(&v, data.data() + pos, sizeof(v));
+        pos += sizeof(v);
+    };
+    auto takeString = [&](std::string& str) {
+        uint32_t len = 0;
+        take(len);
+        ASSERT_LE(pos + len, data.size());
+        str.assign(data, pos, len);
+        pos += len;
+    };
+    uint32_t magic = 0, version = 0, fields = 0;
+    take(magic);
+    take(version);
+    take(fields);
+    EXPECT_EQ(magic, RecordWriter::MAGIC);
+    EXPECT_EQ(version, RecordWriter::VERSION);
+    ASSERT_EQ(fields, 10);
+
+    // min_ele is field 0, total_time 4 and distance 5
+    const std::pair<std::string, uint32_t> expected[] = { { std::string(NAME), 0x31 }, { "bad.gpx", 0 } };
+    const double values[] = { -3.25, 0, 0, 0, 3600, 12.5, 0, 0, 0, 0 };
+    for (const auto& [name, mask] : expected) {
+        std::string readName, error;
+        uint64_t points = 0;
+        uint32_t readMask = 0;
+        takeString(readName);
+        take(points);
+        take(readMask);
+        EXPECT_EQ(readName, name);
+        EXPECT_EQ(readMask, mask);
+        for (uint32_t i = 0; i < fields; ++i) {
+            double v = 0;
+            take(v);
+            if (mask >> i & 1) EXPECT_EQ(v, values[i]);
+            else EXPECT_TRUE(std::isnan(v));
+        }
+        takeString(error);
+        EXPECT_EQ(points, mask ? 7u : 0u);
+        EXPECT_EQ(error, mask ? "" : "stod\tfail");
+    }
+    EXPECT_EQ(pos, data.size());
+    std::remove("records.bin");
+}
+
+TEST_F(RecordWriterTest, FlushReportsWriteErrors) {
+    if (!std::ofstream("/dev/full")) {
+        GTEST_SKIP() << "no /dev/full";
+    }
+    RecordWriter writer("/dev/full", RecordWriter::Csv);
+    EXPECT_THROW(writer.flush(), std::runtime_error);
+}
+
+TEST_F(GPSTest, BatchReportsParseErrors) {
+    TrackGenerator::writeGpx(makeTrack(200), "batch_good.gpx");
+    {
+        std::ofstream bad("batch_bad.gpx");
+        bad << "<trkpt lat=\"north\" lon=\"1\">\n</trkpt>\n";
+    }
+    BatchProcessor batch(1, 1);
+    BatchStats stats = batch.run({ "batch_good.gpx", "batch_bad.gpx" }, "batch_report.txt", "batch_summary.csv");
+    EXPECT_EQ(stats.files, 2);
+    EXPECT_EQ(stats.failed, 1);
+
+    std::ifstream summary("batch_summary.csv");
+    std::stringstream text;
+    text << summary.rdbuf();
+    EXPECT_NE(text.str().find("batch_bad.gpx"), std::string::npos);
+    EXPECT_NE(text.str().find("stod"), std::string::npos);
+    EXPECT_EQ(text.str().find("Wrong type"), std::string::npos);
+
+    EXPECT_THROW(batch.run({ "batch_good.gpx" }, "no_such_dir/report.txt", "batch_summary.csv"), std::runtime_error);
+    EXPECT_THROW(batch.run({ "batch_good.gpx" }, "batch_report.txt", "no_such_dir/summary.csv"), std::runtime_error);
+    if (std::ofstream("/dev/full")) {
+        EXPECT_THROW(batch.run({ "batch_good.gpx", "batch_bad.gpx" }, "batch_report.txt", "/dev/full"), std::runtime_error);
+    }
+    for (const char* f : { "batch_good.gpx", "batch_bad.gpx", "batch_report.txt", "batch_summary.csv" }) {
+        std::remove(f);
+    }
+}
@@ -0,0 +1,318 @@
+#include "WeightedGraph.h"
+
+namespace {
+    const double EARTH_RADIUS_M = 6371000.0;
+    const double METERS_PER_DEGREE = EARTH_RADIUS_M * M_PI / 180.0;
+
+    // Meters between two positions, via the km metric the GPS module uses.
+    double meters(double lat1, double lon1, double lat2, double lon2) {
+        return HaversineMetric::distance({ lat1, lon1, 0, 0 }, { lat2, lon2, 0, 0 }) * 1000.0;
+    }
+
+    struct Projection {
+        double fraction, offset;
+    };
+
+    // Closest point of segment a-b to (lat, lon) in a local flat frame around the point.
+    Projection project(const NodePosition& a, const NodePosition& b, double lat, double lon) {
+        double c = cos(lat * M_PI / 180.0);
+        double ax = (a.lon - lon) * c * METERS_PER_DEGREE, ay = (a.lat - lat) * METERS_PER_DEGREE;
+        double bx = (b.lon - lon) * c * METERS_PER_DEGREE, by = (b.lat - lat) * METERS_PER_DEGREE;
+        double dx = bx - ax, dy = by - ay;
+        double len2 = dx * dx + dy * dy;
+        double t = len2 > 0 ? std::clamp(-(ax * dx + ay * dy) / len2, 0.0, 1.0) : 0.0;
+        return { t, std::hypot(ax + t * dx, ay + t * dy) };
+    }
+}
+
+
+RoadNetwork::RoadNetwork(const Graph& g, const std::unordered_map<vertex, NodePosition, VertexHash>& pos, double cellDegrees)
+    : cellSize(cellDegrees) {
+    if (!(cellSize > 0)) {
+        throw std::runtime_error("error: grid cell must be positive");
+    }
+    const auto& adjacency = g.adjacency();
+    std::unordered_map<vertex, uint32_t, VertexHash> ids;
+    auto idOf = [&](const vertex& v) -> std::optional<uint32_t> {
+        auto known = ids.find(v);
+        if (known != ids.end()) return known->second;
+        auto p = pos.find(v);
+        if (p == pos.end()) return std::nullopt;
+        uint32_t id = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(v);
+        positions.push_back(p->second);
+        ids.emplace(v, id);
+        return id;
+    };
+
+    for (const auto& [v, edges] : adjacency) {
+        auto from = idOf(v);
+        if (!from) continue;
+        for (const edge& e : edges) {
+            auto to = idOf(e.getDestination());
+            if (!to) continue;
+            const NodePosition& a = positions[*from];
+            const NodePosition& b = positions[*to];
+            links.push_back({ *from, *to, e.getWeight(), meters(a.lat, a.lon, b.lat, b.lon) });
+        }
+    }
+
+    outOffsets.assign(vertices.size() + 1, 0);
+    for (const Link& l : links) ++outOffsets[l.from + 1];
+    for (size_t v = 0; v < vertices.size(); ++v) outOffsets[v + 1] += outOffsets[v];
+    outIds.resize(links.size());
+    std::vector<uint32_t> fill(outOffsets.begin(), outOffsets.end() - 1);
+    for (uint32_t id = 0; id < links.size(); ++id) outIds[fill[links[id].from]++] = id;
+
+    for (uint32_t id = 0; id < links.size(); ++id) {
+        const NodePosition& a = positions[links[id].from];
+        const NodePosition& b = positions[links[id].to];
+        int64_t x0 = static_cast<int64_t>(std::floor(std::min(a.lon, b.lon) / cellSize));
+        int64_t x1 = static_cast<int64_t>(std::floor(std::max(a.lon, b.lon) / cellSize));
+        int64_t y0 = static_cast<int64_t>(std::floor(std::min(a.lat, b.lat) / cellSize));
+        int64_t y1 = static_cast<int64_t>(std::floor(std::max(a.lat, b.lat) / cellSize));
+        for (int64_t x = x0; x <= x1; ++x) {
+            for (int64_t y = y0; y <= y1; ++y) grid[cellKey(x, y)].push_back(id);
+        }
+    }
+}
+
+uint64_t RoadNetwork::cellKey(int64_t x, int64_t y) const {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+edge RoadNetwork::getEdge(uint32_t link) const {
+    const Link& l = links[link];
+    return edge(vertices[l.from], vertices[l.to], l.weight);
+}
+
+std::vector<uint32_t> RoadNetwork::linksNear(double lat, double lon, double radius) const {
+    double dLat = radius / METERS_PER_DEGREE;
+    double dLon = dLat / std::max(cos(lat * M_PI / 180.0), 1e-6);
+    int64_t x0 = static_cast<int64_t>(std::floor((lon - dLon) / cellSize));
+    int64_t x1 = static_cast<int64_t>(std::floor((lon + dLon) / cellSize));
+    int64_t y0 = static_cast<int64_t>(std::floor((lat - dLat) / cellSize));
+    int64_t y1 = static_cast<int64_t>(std::floor((lat + dLat) / cellSize));
+    std::vector<uint32_t> res;
+    for (int64_t x = x0; x <= x1; ++x) {
+        for (int64_t y = y0; y <= y1; ++y) {
+            auto it = grid.find(cellKey(x, y));
+            if (it != grid.end()) res.insert(res.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+
+MapMatcher::MapMatcher(const RoadNetwork& net, double searchRadius, double sigmaM, double betaM, size_t maxCand, double maxDetour)
+    : network(net), radius(searchRadius), sigma(sigmaM), beta(betaM), detour(maxDetour), maxCandidates(maxCand) {
+    if (!(radius > 0) || !(sigma > 0) || !(beta > 0) || maxCandidates == 0 || !(detour >= 1)) {
+        throw std::runtime_error("error: invalid map matching parameters");
+    }
+}
+
+std::vector<MapMatcher::Candidate> MapMatcher::candidates(const TrackPoint& p) const {
+    std::vector<Candidate> res;
+    for (uint32_t id : network.linksNear(p.lat, p.lon, radius)) {
+        const RoadNetwork::Link& l = network.getLink(id);
+        Projection pr = project(network.getPosition(l.from), network.getPosition(l.to), p.lat, p.lon);
+        if (pr.offset <= radius) res.push_back({ id, pr.fraction, pr.offset });
+    }
+    if (res.size() > maxCandidates) {
+        std::nth_element(res.begin(), res.begin() + maxCandidates, res.end(),
+            [](const Candidate& a, const Candidate& b) { return a.offset < b.offset; });
+        res.resize(maxCandidates);
+    }
+    return res;
+}
+
+void MapMatcher::shortestFrom(uint32_t source, double bound, Scratch& s) const {
+    for (uint32_t v : s.touched) {
+        s.dist[v] = std::numeric_limits<double>::infinity();
+        s.pred[v] = MatchedPoint::NO_LINK;
+    }
+    s.touched.clear();
+
+    using Item = std::pair<double, uint32_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+    s.dist[source] = 0;
+    s.touched.push_back(source);
+    pq.push({ 0, source });
+    while (!pq.empty()) {
+        auto [d, v] = pq.top();
+        pq.pop();
+        if (d > s.dist[v]) continue;
+        auto [begin, end] = network.outLinks(v);
+        for (const uint32_t* it = begin; it != end; ++it) {
+            const RoadNetwork::Link& l = network.getLink(*it);
+            double nd = d + l.length;
+            if (nd <= bound && nd < s.dist[l.to]) {
+                if (s.dist[l.to] == std::numeric_limits<double>::infinity()) s.touched.push_back(l.to);
+                s.dist[l.to] = nd;
+                s.pred[l.to] = *it;
+                pq.push({ nd, l.to });
+            }
+        }
+    }
+}
+
+MatchResult MapMatcher::match(const std::vector<TrackPoint>& track) const {
+    Scratch s;
+    return match(track, s);
+}
+
+MatchResult MapMatcher::match(const std::vector<TrackPoint>& track, Scratch& s) const {
+    const double inf = std::numeric_limits<double>::infinity();
+    if (s.dist.size() != network.vertexCount()) {
+        s.dist.assign(network.vertexCount(), inf);
+        s.pred.assign(network.vertexCount(), MatchedPoint::NO_LINK);
+        s.touched.clear();
+    }
+
+    MatchResult res;
+    res.points.resize(track.size());
+
+    std::vector<std::vector<Candidate>> cands(track.size());
+    std::vector<std::vector<double>> score(track.size());
+    std::vector<std::vector<int32_t>> back(track.size());
+    std::vector<size_t> chain; // points of the current Viterbi chain
+    std::vector<bool> startsChain(track.size(), false);
+
+    auto emission = [this](const Candidate& c) { return -0.5 * (c.offset / sigma) * (c.offset / sigma); };
+
+    // Backtracks the best state of the chain into res.points.
+    auto closeChain = [&]() {
+        if (chain.empty()) return;
+        const std::vector<double>& last = score[chain.back()];
+        int32_t best = static_cast<int32_t>(std::max_element(last.begin(), last.end()) - last.begin());
+        for (size_t k = chain.size(); k-- > 0;) {
+            size_t t = chain[k];
+            const Candidate& c = cands[t][best];
+            res.points[t] = { c.link, c.fraction, c.offset };
+            best = back[t][best];
+        }
+        chain.clear();
+    };
+
+    for (size_t t = 0; t < track.size(); ++t) {
+        cands[t] = candidates(track[t]);
+        if (cands[t].empty()) continue;
+        const size_t m = cands[t].size();
+        score[t].assign(m, -inf);
+        back[t].assign(m, -1);
+
+        if (!chain.empty()) {
+            size_t tp = chain.back();
+            const TrackPoint& a = track[tp];
+            const TrackPoint& b = track[t];
+            double gc = meters(a.lat, a.lon, b.lat, b.lon);
+            double bound = detour * gc + 2 * radius;
+            for (size_t i = 0; i < cands[tp].size(); ++i) {
+                if (score[tp][i] == -inf) continue;
+                const Candidate& from = cands[tp][i];
+                const RoadNetwork::Link& fl = network.getLink(from.link);
+                double rest = (1 - from.fraction) * fl.length;
+                shortestFrom(fl.to, std::max(bound - rest, 0.0), s);
+                for (size_t j = 0; j < m; ++j) {
+                    const Candidate& to = cands[t][j];
+                    const RoadNetwork::Link& tl = network.getLink(to.link);
+                    double route = to.link == from.link && to.fraction >= from.fraction
+                        ? (to.fraction - from.fraction) * fl.length
+                        : rest + s.dist[tl.from] + to.fraction * tl.length;
+                    if (!(route <= bound)) continue;
+                    double sc = score[tp][i] - std::abs(gc - route) / beta;
+                    if (sc > score[t][j]) {
+                        score[t][j] = sc;
+                        back[t][j] = static_cast<int32_t>(i);
+                    }
+                }
+            }
+            bool reachable = false;
+            for (size_t j = 0; j < m; ++j) {
+                if (score[t][j] != -inf) {
+                    score[t][j] += emission(cands[t][j]);
+                    reachable = true;
+                }
+            }
+            if (!reachable) {
+                closeChain();
+                ++res.breaks;
+            }
+        }
+        if (chain.empty()) {
+            for (size_t j = 0; j < m; ++j) score[t][j] = emission(cands[t][j]);
+            startsChain[t] = true;
+        }
+        chain.push_back(t);
+    }
+    closeChain();
+
+    // Expand consecutive matches into the links between them.
+    auto push = [&res, this](uint32_t link) {
+        edge e = network.getEdge(link);
+        if (res.path.empty() || !(res.path.back() == e)) {
+            res.path.push_back(e);
+            res.weight += e.getWeight();
+        }
+    };
+    // A chain that starts at the very end of its first link, or stops at the very
+    // start of its last one, does not traverse that link.
+    std::vector<size_t> matched;
+    for (size_t t = 0; t < track.size(); ++t) {
+        if (res.points[t].link != MatchedPoint::NO_LINK) matched.push_back(t);
+    }
+    for (size_t k = 0; k < matched.size(); ++k) {
+        size_t t = matched[k];
+        const MatchedPoint& cur = res.points[t];
+        bool first = startsChain[t];
+        bool last = k + 1 == matched.size() || startsChain[matched[k + 1]];
+        if (!first) {
+            size_t prev = matched[k - 1];
+            const MatchedPoint& p = res.points[prev];
+            if (!(p.link == cur.link && cur.fraction >= p.fraction)) {
+                const RoadNetwork::Link& fl = network.getLink(p.link);
+                const RoadNetwork::Link& tl = network.getLink(cur.link);
+                double gc = meters(track[prev].lat, track[prev].lon, track[t].lat, track[t].lon);
+                shortestFrom(fl.to, detour * gc + 2 * radius, s);
+                std::vector<uint32_t> between;
+                bool linked = true;
+                for (uint32_t v = tl.from; v != fl.to; v = network.getLink(s.pred[v]).from) {
+                    if (s.pred[v] == MatchedPoint::NO_LINK) {
+                        linked = false;
+                        break;
+                    }
+                    between.push_back(s.pred[v]);
+                }
+                if (linked) {
+                    std::reverse(between.begin(), between.end());
+                    for (uint32_t id : between) push(id);
+                }
+                else {
+                    // No route within the bound after all: restart the path here.
+                    ++res.breaks;
+                    first = true;
+                }
+            }
+        }
+        if (!(first && !last && cur.fraction >= 1) && !(last && !first && cur.fraction <= 0)) push(cur.link);
+    }
+    return res;
+}
+
+std::vector<MatchResult> MapMatcher::matchAll(const std::vector<std::vector<TrackPoint>>& tracks, size_t threads) const {
+    std::vector<MatchResult> res(tracks.size());
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        Scratch s;
+        for (size_t i = next++; i < tracks.size(); i = next++) {
+            res[i] = match(tracks[i], s);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::max<size_t>(threads, 1); ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    return res;
+}
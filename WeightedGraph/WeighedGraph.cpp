@@ -63,6 +63,26 @@ Graph readFromWeightedFile::getGrph(const std::string& filename) {
     }
 
 
+std::unordered_map<vertex, NodePosition, VertexHash> readFromWeightedFile::getPositions(const std::string& filename) {
+    std::unordered_map<vertex, NodePosition, VertexHash> res;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    std::string line;
+    while (getline(file, line)) {
+        std::stringstream ss(line);
+        std::string name, lat, lon;
+        if (getline(ss, name, ':') && getline(ss, lat, ',') && getline(ss, lon) && !name.empty()) {
+            res[vertex(name)] = { std::stod(lat), std::stod(lon) };
+        }
+        else if (!line.empty()) {
+            throw std::runtime_error("warning: invalid format: " + filename);
+        }
+    }
+    return res;
+}
+
 
 edge::edge() {}
 edge::edge(const vertex& u,const vertex& v,const size_t wght) : source(u), destination(v), weight(wght) {}
@@ -107,6 +127,24 @@ std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> Graph
     return graph;
 }
 
+bool Graph::contains(const vertex& v) const {
+    return graph.find(v) != graph.end();
+}
+
+const std::unordered_set<edge, EdgeHash>& Graph::neighbors(const vertex& v) const {
+    static const std::unordered_set<edge, EdgeHash> none;
+    auto it = graph.find(v);
+    return it != graph.end() ? it->second : none;
+}
+
+const std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash>& Graph::adjacency() const {
+    return graph;
+}
+
+size_t Graph::vertexCount() const {
+    return graph.size();
+}
+
 
 
 PathFinder::PathFinder(const Graph& g, const vertex& A, const vertex& B): pathWght(0) {}
@@ -153,12 +191,11 @@ dijkstraPathFinder::dijkstraPathFinder(const Graph& g, const vertex& A, const ve
 
 size_t dijkstraPathFinder::WeightOfPath(const Graph& g) const {
     int totalWght = 0;
-    const auto& AdjacencyList = g.getAdjacencyList();
     for (size_t i = 0; i + 1 < path.size(); ++i) {
-        vertex u = path[i];
-        vertex v = path[i+1];
+        const vertex& u = path[i];
+        const vertex& v = path[i+1];
         bool fl = false;
-        for (const edge& edge : AdjacencyList.at(u)) {
+        for (const edge& edge : g.neighbors(u)) {
             if (edge.getDestination() == v) {
                 totalWght += edge.getWeight();
                 fl = true;
@@ -173,8 +210,7 @@ size_t dijkstraPathFinder::WeightOfPath(const Graph& g) const {
 }
 
 std::vector<vertex> dijkstraPathFinder::ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const{
-        const auto& AdjacencyList = g.getAdjacencyList();
-        if (AdjacencyList.find(start) == AdjacencyList.end() || AdjacencyList.find(goal) == AdjacencyList.end()) {
+        if (!g.contains(start) || !g.contains(goal)) {
             throw std::runtime_error("error: start or goal node not exist");
         }
         
@@ -182,11 +218,13 @@ std::vector<vertex> dijkstraPathFinder::ShortestPath(const vertex& start, const
         std::priority_queue<std::pair<int, vertex>, std::vector<std::pair<int, vertex>>, std::greater<std::pair<int, vertex>>> pq;
         pq.push({ 0, start });
 
+        // Only reached vertices get an entry, so a query never touches the rest of the graph.
         std::unordered_map<vertex, int, VertexHash> dist;
         std::unordered_map<vertex, vertex, VertexHash> prev;
-        for (const auto& edge : AdjacencyList) {
-            dist[edge.first] = std::numeric_limits<int>::max();
-        }
+        auto distTo = [&dist](const vertex& v) {
+            auto it = dist.find(v);
+            return it != dist.end() ? it->second : std::numeric_limits<int>::max();
+        };
         dist[start] = 0;
 
         while (!pq.empty()) {
@@ -198,17 +236,17 @@ std::vector<vertex> dijkstraPathFinder::ShortestPath(const vertex& start, const
                 return reconstructPath(prev, start, goal);
             }
 
-            if (currentDist > dist[currentVer]) {
+            if (currentDist > distTo(currentVer)) {
                 continue;
             }
             
 
 
-            for (const edge& neighbor : AdjacencyList.at(currentVer)) {
+            for (const edge& neighbor : g.neighbors(currentVer)) {
 
                 int newDist = currentDist + neighbor.getWeight();
 
-                if (newDist < dist[neighbor.getDestination()]) {
+                if (newDist < distTo(neighbor.getDestination())) {
                     dist[neighbor.getDestination()] = newDist;
                     prev[neighbor.getDestination()] = currentVer;
                     pq.push({ newDist, neighbor.getDestination()});
@@ -1,3 +1,5 @@
+#pragma once
+#include "../GPS/Geo.h"
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
@@ -6,6 +8,11 @@
 #include <queue>
 #include <stack>
 #include <optional>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 class vertex final{
 public:
@@ -51,6 +58,13 @@ public:
     void addEdge(const edge& Edge);
 
     std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> getAdjacencyList() const;
+
+    // Read-only views into the graph, nothing is copied.
+    bool contains(const vertex& v) const;
+    // Outgoing edges of v; an empty set for unknown vertices.
+    const std::unordered_set<edge, EdgeHash>& neighbors(const vertex& v) const;
+    const std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash>& adjacency() const;
+    size_t vertexCount() const;
 private:
     std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> graph;
 };
@@ -58,10 +72,16 @@ private:
 
 
 
+struct NodePosition {
+    double lat, lon;
+};
+
 class readFromWeightedFile final{
 public:
     readFromWeightedFile() = delete;
     static Graph getGrph(const std::string& filename);
+    // Lines "name:lat,lon".
+    static std::unordered_map<vertex, NodePosition, VertexHash> getPositions(const std::string& filename);
 };
 
 
@@ -95,4 +115,92 @@ public:
     size_t WeightOfPath(const Graph& g) const;
 private:
     std::vector<vertex> reconstructPath(const std::unordered_map<vertex, vertex, VertexHash>& previous, const vertex& start, const vertex& goal) const;
-};
\ No newline at end of file
+};
+
+
+
+// Dense copy of a Graph whose vertices have positions: directed links with their
+// length in meters, outgoing links per vertex and a grid over link geometry.
+class RoadNetwork final {
+public:
+    struct Link {
+        uint32_t from, to;
+        size_t weight;
+        double length;
+    };
+
+    RoadNetwork(const Graph& g, const std::unordered_map<vertex, NodePosition, VertexHash>& positions, double cellDegrees = 0.005);
+
+    size_t vertexCount() const { return vertices.size(); }
+    size_t linkCount() const { return links.size(); }
+    const vertex& getVertex(uint32_t id) const { return vertices[id]; }
+    const NodePosition& getPosition(uint32_t id) const { return positions[id]; }
+    const Link& getLink(uint32_t id) const { return links[id]; }
+    edge getEdge(uint32_t link) const;
+
+    // [begin, end) of the ids of links leaving v.
+    std::pair<const uint32_t*, const uint32_t*> outLinks(uint32_t v) const {
+        return { outIds.data() + outOffsets[v], outIds.data() + outOffsets[v + 1] };
+    }
+    // Links whose grid cells come within radius meters of the point; a superset.
+    std::vector<uint32_t> linksNear(double lat, double lon, double radius) const;
+
+private:
+    uint64_t cellKey(int64_t x, int64_t y) const;
+
+    std::vector<vertex> vertices;
+    std::vector<NodePosition> positions;
+    std::vector<Link> links;
+    std::vector<uint32_t> outOffsets, outIds;
+    double cellSize;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+};
+
+
+struct MatchedPoint {
+    static constexpr uint32_t NO_LINK = UINT32_MAX;
+    uint32_t link = NO_LINK;
+    double fraction = 0; // position along the link
+    double offset = 0;   // meters from the GPS point to the link
+};
+
+struct MatchResult {
+    std::vector<MatchedPoint> points; // one per track point
+    std::vector<edge> path;           // traversed edges in order; has gaps where matching restarted
+    size_t weight = 0;
+    size_t breaks = 0;
+};
+
+// HMM map matching (Newson & Krumm): candidates are link projections within the
+// search radius, emissions are Gaussian in the offset, transitions exponential in
+// |great-circle distance - route distance|, with routes from Dijkstra bounded by
+// maxDetour times the great-circle distance. Viterbi restarts when no route fits.
+class MapMatcher final {
+public:
+    MapMatcher(const RoadNetwork& net, double searchRadius = 50, double sigma = 10, double beta = 20,
+        size_t maxCandidates = 8, double maxDetour = 3);
+
+    MatchResult match(const std::vector<TrackPoint>& track) const;
+    std::vector<MatchResult> matchAll(const std::vector<std::vector<TrackPoint>>& tracks,
+        size_t threads = std::thread::hardware_concurrency()) const;
+
+private:
+    struct Candidate {
+        uint32_t link;
+        double fraction, offset;
+    };
+    // Per-thread Dijkstra state, reset through the touched list.
+    struct Scratch {
+        std::vector<double> dist;
+        std::vector<uint32_t> pred;
+        std::vector<uint32_t> touched;
+    };
+
+    std::vector<Candidate> candidates(const TrackPoint& p) const;
+    void shortestFrom(uint32_t source, double bound, Scratch& s) const;
+    MatchResult match(const std::vector<TrackPoint>& track, Scratch& s) const;
+
+    const RoadNetwork& network;
+    double radius, sigma, beta, detour;
+    size_t maxCandidates;
+};
@@ -1,6 +1,8 @@
 #include "WeightedGraph.h"
 #include <gtest/gtest.h>
 #include <stdexcept>
+#include <filesystem>
+#include <cstdio>
 
 //class GraphTest : public ::testing::Test {
 //protected:
@@ -213,4 +215,54 @@ TEST_F(GraphTest, SingleEdge) {
 
 
     EXPECT_EQ(finder1.getPathWght(), 2);
-}
\ No newline at end of file
+}
+TEST_F(GraphTest, MapMatchingFollowsRoad) {
+    // 5x5 grid of streets ~110 m apart; the track runs east along row 2 and
+    // turns north at column 3, with a few meters of lateral noise.
+    std::vector<std::string> edges;
+    const std::string dir = std::filesystem::temp_directory_path().string() + "/";
+    const std::string positionsFile = dir + "mapmatch_positions.txt", roadsFile = dir + "mapmatch_roads.txt";
+    std::ofstream positions(positionsFile);
+    positions << std::setprecision(10);
+    auto name = [](int r, int c) { return std::string(1, 'a' + r) + std::to_string(c); };
+    for (int r = 0; r < 5; ++r) {
+        for (int c = 0; c < 5; ++c) {
+            positions << name(r, c) << ":" << 55.0 + r * 0.001 << "," << 37.0 + c * 0.00175 << "\n";
+            if (c + 1 < 5) edges.push_back(name(r, c) + "-" + name(r, c + 1) + ":1");
+            if (r + 1 < 5) edges.push_back(name(r, c) + "-" + name(r + 1, c) + ":2");
+        }
+    }
+    positions.close();
+    createGraphFile(roadsFile, edges);
+    Graph Gr = readFromWeightedFile::getGrph(roadsFile);
+    RoadNetwork net(Gr, readFromWeightedFile::getPositions(positionsFile));
+    std::remove(roadsFile.c_str());
+    std::remove(positionsFile.c_str());
+    EXPECT_EQ(net.vertexCount(), 25);
+    EXPECT_EQ(net.linkCount(), 80);
+
+    std::vector<TrackPoint> track;
+    for (int i = 0; i <= 12; ++i) {
+        track.push_back({ 55.002 + (i % 2 ? 0.00003 : -0.00003), 37.0 + i * 0.00175 / 4, 0, i * 10 });
+    }
+    for (int i = 1; i <= 8; ++i) {
+        track.push_back({ 55.002 + i * 0.001 / 4, 37.00525 + (i % 2 ? 0.00004 : -0.00004), 0, 120 + i * 10 });
+    }
+
+    MapMatcher matcher(net);
+    std::vector<MatchResult> results = matcher.matchAll({ track, track }, 2);
+    const MatchResult& res = results[0];
+    std::vector<std::string> path;
+    for (const edge& e : res.path) {
+        path.push_back(e.getSource().takeName() + "-" + e.getDestination().takeName());
+    }
+    std::vector<std::string> expected = { "c0-c1", "c1-c2", "c2-c3", "c3-d3", "d3-e3" };
+    EXPECT_EQ(path, expected);
+    EXPECT_EQ(res.weight, 1 + 1 + 1 + 2 + 2);
+    EXPECT_EQ(res.breaks, 0);
+    for (const MatchedPoint& p : res.points) {
+        EXPECT_NE(p.link, MatchedPoint::NO_LINK);
+        EXPECT_LT(p.offset, 10);
+    }
+    EXPECT_EQ(results[1].path.size(), res.path.size());
+}
@@ -0,0 +1,98 @@
+#include "graph.h"
+
+ComponentIndex::ComponentIndex(const ComponentIndex& other, const Graph& owner)
+    : parent(other.parent), rank(other.rank), count(other.count) {
+    ids.reserve(other.ids.size());
+    for (const auto& entry : owner.adjacency()) {
+        std::string_view name = entry.first.takeName();
+        ids.emplace(name, other.ids.at(name));
+    }
+}
+
+void ComponentIndex::add(const vertex& v) {
+    if (!ids.emplace(v.takeName(), static_cast<uint32_t>(parent.size())).second) {
+        return;
+    }
+    parent.push_back(static_cast<uint32_t>(parent.size()));
+    rank.push_back(0);
+    ++count;
+}
+
+// No path compression, so lookups stay const and safe to share between
+// threads; union by rank keeps every tree O(log n) deep.
+uint32_t ComponentIndex::find(uint32_t x) const {
+    while (parent[x] != x) x = parent[x];
+    return x;
+}
+
+void ComponentIndex::unite(const vertex& a, const vertex& b) {
+    uint32_t x = find(ids.at(a.takeName()));
+    uint32_t y = find(ids.at(b.takeName()));
+    if (x == y) return;
+    if (rank[x] < rank[y]) std::swap(x, y);
+    parent[y] = x;
+    if (rank[x] == rank[y]) ++rank[x];
+    --count;
+}
+
+bool ComponentIndex::connected(const vertex& a, const vertex& b) const {
+    auto x = ids.find(a.takeName());
+    auto y = ids.find(b.takeName());
+    if (x == ids.end() || y == ids.end()) return false;
+    return find(x->second) == find(y->second);
+}
+
+
+// Lock-free union-find: a root is only ever linked below a smaller id and path
+// halving only shortens links, so parents keep decreasing and no cycle can form.
+void CsrGraph::labelComponents(size_t threads) {
+    const size_t PARALLEL_EDGES = 1 << 20;
+    const size_t CHUNK = 1024;
+    const size_t n = names.size();
+    std::vector<std::atomic<uint32_t>> parent(n);
+    for (uint32_t v = 0; v < n; ++v) parent[v].store(v, std::memory_order_relaxed);
+
+    auto find = [&parent](uint32_t x) {
+        while (true) {
+            uint32_t p = parent[x].load(std::memory_order_relaxed);
+            if (p == x) return x;
+            uint32_t gp = parent[p].load(std::memory_order_relaxed);
+            if (gp != p) parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            x = gp;
+        }
+    };
+    auto unite = [&](uint32_t a, uint32_t b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            uint32_t root = a;
+            if (parent[a].compare_exchange_strong(root, b, std::memory_order_relaxed)) return;
+        }
+    };
+
+    if (threads == 0) {
+        threads = targets.size() < PARALLEL_EDGES ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::atomic<size_t> nextChunk{ 0 };
+    auto worker = [&]() {
+        for (size_t begin = nextChunk.fetch_add(CHUNK); begin < n; begin = nextChunk.fetch_add(CHUNK)) {
+            size_t end = std::min(begin + CHUNK, n);
+            for (uint32_t v = static_cast<uint32_t>(begin); v < end; ++v) {
+                for (uint32_t u : neighbors(v)) unite(v, u);
+            }
+        }
+    };
+    std::vector<std::thread> team;
+    for (size_t i = 1; i < threads; ++i) team.emplace_back(worker);
+    worker();
+    for (auto& t : team) t.join();
+
+    componentOf.resize(n);
+    components = 0;
+    for (uint32_t v = 0; v < n; ++v) {
+        componentOf[v] = find(v);
+        if (componentOf[v] == v) ++components;
+    }
+}
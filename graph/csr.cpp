@@ -0,0 +1,354 @@
+#include "graph.h"
+
+CsrGraph::CsrGraph(const Graph& g, size_t threads) {
+    const auto& adjacency = g.adjacency();
+    names.reserve(adjacency.size());
+    for (const auto& entry : adjacency) {
+        names.push_back(entry.first);
+    }
+    // Sorted names give ids that do not depend on hash order.
+    std::sort(names.begin(), names.end(), [](const vertex& a, const vertex& b) { return a.takeName() < b.takeName(); });
+    indexNames();
+
+    offsets.assign(names.size() + 1, 0);
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        offsets[i + 1] = offsets[i] + static_cast<uint32_t>(adjacency.at(names[i]).size());
+    }
+    targets.resize(offsets.back());
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        uint32_t* out = targets.data() + offsets[i];
+        for (const edge& e : adjacency.at(names[i])) {
+            *out++ = ids.at(e.getDestination().takeName());
+        }
+        std::sort(targets.data() + offsets[i], out);
+    }
+    buildReverse();
+    labelComponents(threads);
+}
+
+void CsrGraph::indexNames() {
+    ids.clear();
+    ids.reserve(names.size());
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        ids.emplace(names[i].takeName(), i);
+    }
+}
+
+void CsrGraph::buildReverse() {
+    inOffsets.assign(names.size() + 1, 0);
+    for (uint32_t t : targets) ++inOffsets[t + 1];
+    for (size_t i = 0; i < names.size(); ++i) inOffsets[i + 1] += inOffsets[i];
+    inTargets.resize(targets.size());
+    std::vector<uint32_t> fill(inOffsets.begin(), inOffsets.end() - 1);
+    // Sources are visited in increasing order, so every in-list comes out sorted.
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        for (uint32_t t : neighbors(i)) inTargets[fill[t]++] = i;
+    }
+}
+
+std::optional<uint32_t> CsrGraph::id(const vertex& v) const {
+    auto it = ids.find(v.takeName());
+    if (it == ids.end()) return std::nullopt;
+    return it->second;
+}
+
+
+namespace {
+    std::pair<uint32_t, uint32_t> endpoints(const CsrGraph& g, const vertex& A, const vertex& B) {
+        auto start = g.id(A);
+        auto goal = g.id(B);
+        if (!start || !goal) {
+            throw std::runtime_error("error: start or goal node not exist");
+        }
+        if (!g.connected(*start, *goal)) {
+            throw std::runtime_error("error: path not exist");
+        }
+        return { *start, *goal };
+    }
+
+    std::vector<vertex> toVertices(const CsrGraph& g, const std::vector<uint32_t>& ids) {
+        std::vector<vertex> res;
+        res.reserve(ids.size());
+        for (uint32_t id : ids) res.push_back(g.getVertex(id));
+        return res;
+    }
+
+    std::vector<uint32_t> unwind(const std::vector<uint32_t>& preds, uint32_t start, uint32_t goal) {
+        std::vector<uint32_t> path;
+        for (uint32_t v = goal; v != start; v = preds[v]) {
+            path.push_back(v);
+        }
+        path.push_back(start);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+}
+
+dfsPathFinder::dfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B) {
+    try {
+        auto [start, goal] = endpoints(g, A, B);
+        path = toVertices(g, ShortestPath(start, goal, g));
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+}
+
+std::vector<uint32_t> dfsPathFinder::ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const {
+    std::vector<bool> visited(g.vertexCount(), false);
+    std::vector<uint32_t> preds(g.vertexCount(), start);
+    // (vertex, the vertex it was reached from)
+    std::vector<std::pair<uint32_t, uint32_t>> stack{ { start, start } };
+
+    while (!stack.empty()) {
+        auto [node, from] = stack.back();
+        stack.pop_back();
+        if (visited[node]) {
+            continue;
+        }
+        visited[node] = true;
+        preds[node] = from;
+
+        if (node == goal) {
+            return unwind(preds, start, goal);
+        }
+        for (uint32_t next : g.neighbors(node)) {
+            if (!visited[next]) {
+                stack.push_back({ next, node });
+            }
+        }
+    }
+    throw std::runtime_error("error: path not exist");
+}
+
+bfsPathFinder::bfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B) {
+    try {
+        auto [start, goal] = endpoints(g, A, B);
+        path = toVertices(g, ShortestPath(start, goal, g));
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+}
+
+// Direction-optimizing BFS (Beamer et al.): top-down steps expand the frontier
+// list; once its edges outnumber the unexplored ones / ALPHA, bottom-up steps let
+// every unvisited vertex look for a parent in the frontier bitmap, until the
+// frontier shrinks below n / BETA. Both assign each vertex a pred one level up,
+// so paths are shortest either way.
+std::vector<uint32_t> bfsPathFinder::ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const {
+    const size_t ALPHA = 14, BETA = 24;
+    const size_t n = g.vertexCount();
+    const size_t words = (n + 63) / 64;
+    std::vector<uint64_t> visited(words, 0), frontierBits(words, 0);
+    auto test = [](const std::vector<uint64_t>& bits, uint32_t v) { return (bits[v >> 6] >> (v & 63)) & 1; };
+    auto set = [](std::vector<uint64_t>& bits, uint32_t v) { bits[v >> 6] |= uint64_t(1) << (v & 63); };
+
+    std::vector<uint32_t> preds(n, start);
+    std::vector<uint32_t> frontier{ start }, next;
+    set(visited, start);
+    size_t unexploredEdges = g.edgeCount() - g.neighbors(start).size();
+    bool bottomUp = false;
+
+    while (!frontier.empty() && !test(visited, goal)) {
+        size_t frontierEdges = 0;
+        for (uint32_t v : frontier) frontierEdges += g.neighbors(v).size();
+        if (!bottomUp && frontierEdges > unexploredEdges / ALPHA) bottomUp = true;
+        else if (bottomUp && frontier.size() < n / BETA) bottomUp = false;
+
+        next.clear();
+        if (bottomUp) {
+            std::fill(frontierBits.begin(), frontierBits.end(), 0);
+            for (uint32_t v : frontier) set(frontierBits, v);
+            for (uint32_t v = 0; v < n; ++v) {
+                if (test(visited, v)) continue;
+                for (uint32_t u : g.inNeighbors(v)) {
+                    if (test(frontierBits, u)) {
+                        set(visited, v);
+                        preds[v] = u;
+                        next.push_back(v);
+                        break;
+                    }
+                }
+            }
+        }
+        else {
+            for (uint32_t u : frontier) {
+                for (uint32_t v : g.neighbors(u)) {
+                    if (!test(visited, v)) {
+                        set(visited, v);
+                        preds[v] = u;
+                        next.push_back(v);
+                    }
+                }
+            }
+        }
+        for (uint32_t v : next) unexploredEdges -= g.neighbors(v).size();
+        frontier.swap(next);
+    }
+    if (!test(visited, goal)) {
+        throw std::runtime_error("error: path not exist");
+    }
+    return unwind(preds, start, goal);
+}
+
+
+bidirectionalBfsPathFinder::bidirectionalBfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B) {
+    try {
+        auto [start, goal] = endpoints(g, A, B);
+        path = toVertices(g, ShortestPath(start, goal, g));
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+}
+
+std::vector<uint32_t> bidirectionalBfsPathFinder::ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const {
+    const uint32_t NONE = UINT32_MAX;
+    const size_t n = g.vertexCount();
+    // Forward: pred and distance from start; backward: successor and distance to goal.
+    std::vector<uint32_t> pred(n, NONE), succ(n, NONE), distF(n, NONE), distB(n, NONE);
+    pred[start] = start;
+    distF[start] = 0;
+    succ[goal] = goal;
+    distB[goal] = 0;
+    std::vector<uint32_t> frontF{ start }, frontB{ goal }, next;
+    uint32_t meet = start == goal ? start : NONE;
+
+    while (meet == NONE && !frontF.empty() && !frontB.empty()) {
+        bool forward = frontF.size() <= frontB.size();
+        std::vector<uint32_t>& front = forward ? frontF : frontB;
+        std::vector<uint32_t>& link = forward ? pred : succ;
+        std::vector<uint32_t>& dist = forward ? distF : distB;
+        const std::vector<uint32_t>& other = forward ? distB : distF;
+        size_t best = SIZE_MAX;
+        next.clear();
+        for (uint32_t u : front) {
+            for (uint32_t v : forward ? g.neighbors(u) : g.inNeighbors(u)) {
+                if (dist[v] != NONE) continue;
+                dist[v] = dist[u] + 1;
+                link[v] = u;
+                next.push_back(v);
+                if (other[v] != NONE && size_t(dist[v]) + other[v] < best) {
+                    best = size_t(dist[v]) + other[v];
+                    meet = v;
+                }
+            }
+        }
+        front.swap(next);
+    }
+    if (meet == NONE) {
+        throw std::runtime_error("error: path not exist");
+    }
+    std::vector<uint32_t> res = unwind(pred, start, meet);
+    for (uint32_t v = meet; v != goal; ) {
+        v = succ[v];
+        res.push_back(v);
+    }
+    return res;
+}
+
+parallelBfsPathFinder::parallelBfsPathFinder(const Graph& g, const vertex& A, const vertex& B, size_t threads)
+    : PathFinder(g, A, B), threadCount(std::max<size_t>(threads, 1)) {
+    try {
+        path = ShortestPath(A, B, g);
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+}
+
+parallelBfsPathFinder::parallelBfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B, size_t threads)
+    : threadCount(std::max<size_t>(threads, 1)) {
+    try {
+        auto [start, goal] = endpoints(g, A, B);
+        path = toVertices(g, ShortestPath(start, goal, g));
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+}
+
+std::vector<vertex> parallelBfsPathFinder::ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const {
+    if (!g.contains(start) || !g.contains(goal)) {
+        throw std::runtime_error("error: start or goal node not exist");
+    }
+    // Cheap rejection before paying for the freeze.
+    if (!g.connected(start, goal)) {
+        throw std::runtime_error("error: path not exist");
+    }
+    CsrGraph csr(g);
+    auto [s, t] = endpoints(csr, start, goal);
+    return toVertices(csr, ShortestPath(s, t, csr));
+}
+
+std::vector<uint32_t> parallelBfsPathFinder::ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const {
+    const size_t CHUNK = 256;
+    const size_t n = g.vertexCount();
+    std::vector<std::atomic<uint64_t>> visited((n + 63) / 64);
+    for (auto& w : visited) w.store(0, std::memory_order_relaxed);
+    visited[start >> 6].fetch_or(uint64_t(1) << (start & 63), std::memory_order_relaxed);
+
+    std::vector<uint32_t> preds(n, start);
+    std::vector<uint32_t> frontier{ start };
+    std::vector<std::vector<uint32_t>> local(threadCount);
+    std::atomic<size_t> nextChunk{ 0 };
+    bool done = start == goal;
+
+    // Runs on one thread between levels, after every worker has arrived.
+    auto joinLevel = [&]() noexcept {
+        frontier.clear();
+        for (auto& buf : local) {
+            frontier.insert(frontier.end(), buf.begin(), buf.end());
+            buf.clear();
+        }
+        nextChunk.store(0, std::memory_order_relaxed);
+        done = frontier.empty() || (visited[goal >> 6].load(std::memory_order_relaxed) >> (goal & 63)) & 1;
+    };
+    std::barrier level(static_cast<std::ptrdiff_t>(threadCount), joinLevel);
+
+    auto worker = [&](size_t id) {
+        std::vector<uint32_t>& out = local[id];
+        while (!done) {
+            for (size_t begin = nextChunk.fetch_add(CHUNK); begin < frontier.size(); begin = nextChunk.fetch_add(CHUNK)) {
+                size_t end = std::min(begin + CHUNK, frontier.size());
+                for (size_t i = begin; i < end; ++i) {
+                    uint32_t u = frontier[i];
+                    for (uint32_t v : g.neighbors(u)) {
+                        uint64_t bit = uint64_t(1) << (v & 63);
+                        if (visited[v >> 6].load(std::memory_order_relaxed) & bit) continue;
+                        if (!(visited[v >> 6].fetch_or(bit, std::memory_order_relaxed) & bit)) {
+                            preds[v] = u;
+                            out.push_back(v);
+                        }
+                    }
+                }
+            }
+            level.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> team;
+    try {
+        for (size_t i = 1; i < threadCount; ++i) team.emplace_back(worker, i);
+    }
+    catch (...) {
+        // The barrier counts threadCount members: drop the ones that never started
+        // and this thread's own, so the started workers can finish and be joined.
+        for (size_t i = team.size(); i < threadCount; ++i) level.arrive_and_drop();
+        for (auto& t : team) t.join();
+        throw;
+    }
+    worker(0);
+    for (auto& t : team) t.join();
+
+    if (!((visited[goal >> 6].load() >> (goal & 63)) & 1)) {
+        throw std::runtime_error("error: path not exist");
+    }
+    return unwind(preds, start, goal);
+}
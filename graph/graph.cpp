@@ -8,7 +8,7 @@ bool vertex:: operator == (const vertex& ver2) const{
     }
 
 
-std::string vertex::takeName() const{
+const std::string& vertex::takeName() const{
         return verName;
     }
 
@@ -28,19 +28,11 @@ std::size_t EdgeHash::operator()(const edge& v) const {
 
 readFromUnweightedFile::readFromUnweightedFile(const std::string& filename) {
     Graph gr;
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("error: dont open " + filename);
-        }
-        std::string line;
-        while (getline(file, line)) {
-            std::stringstream ss(line);
-            std::string u, v;
-
-            if (getline(ss, u, '-') && getline(ss, v)) {
-                if (!u.empty() && !v.empty()) {
-                    vertex ver1(u);
-                    vertex ver2(v);
+        EdgeListParser parser(filename);
+        for (const auto& chunk : parser.chunks()) {
+            for (const auto& [u, v] : chunk) {
+                    vertex ver1{ std::string(u) };
+                    vertex ver2{ std::string(v) };
                     edge uv(ver1, ver2);
                     edge vu(ver2, ver1);
                     try {
@@ -50,14 +42,9 @@ readFromUnweightedFile::readFromUnweightedFile(const std::string& filename) {
                     catch (std::runtime_error& a) {
                         std::cout << a.what();              
                     }
-                }
-            }
-            else {
-               throw std::runtime_error("warning: invalid format: " + filename);
             }
         }
         Grph = gr;
-        file.close();
     }
 
 Graph readFromUnweightedFile::getGrph() const{
@@ -84,11 +71,21 @@ vertex edge::getDestination() const{
 
 
 Graph::Graph() {}
+Graph::Graph(const Graph& other) : graph(other.graph), components(other.components, *this) {}
+
+Graph& Graph::operator=(const Graph& other) {
+    if (this != &other) {
+        *this = Graph(other);
+    }
+    return *this;
+}
 void Graph::addVertex(const vertex& newVer){
-        if (graph.find(newVer) != graph.end()) {           
+        auto res = graph.try_emplace(newVer);
+        if (!res.second) {
             return;
-        }     
-        graph[newVer];
+        }
+        // the stored key, which the component index views
+        components.add(res.first->first);
     }
 
 //void Graph::addEdge(const edge& Edge) {
@@ -110,6 +107,7 @@ void Graph::addEdge(const edge& Edge) {
     if (!res.second) {
         throw std::runtime_error("warning: two same edges");
     }
+    components.unite(Edge.getSource(), Edge.getDestination());
 }
 
 
@@ -117,6 +115,24 @@ std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> Graph
         return graph;
     }
 
+bool Graph::contains(const vertex& v) const {
+    return graph.find(v) != graph.end();
+}
+
+const std::unordered_set<edge, EdgeHash>& Graph::neighbors(const vertex& v) const {
+    static const std::unordered_set<edge, EdgeHash> none;
+    auto it = graph.find(v);
+    return it != graph.end() ? it->second : none;
+}
+
+const std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash>& Graph::adjacency() const {
+    return graph;
+}
+
+size_t Graph::vertexCount() const {
+    return graph.size();
+}
+
 
 
 PathFinder::PathFinder(const Graph& g, const vertex& A, const vertex& B) {}
@@ -156,10 +172,12 @@ dfsPathFinder::dfsPathFinder(const Graph& g, const vertex& A, const vertex& B)
     }  
     }
 std::vector<vertex> dfsPathFinder::ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const{
-        const auto& AdjacencyList = g.getAdjacencyList();
-        if (AdjacencyList.find(start) == AdjacencyList.end() || AdjacencyList.find(goal) == AdjacencyList.end()) {
+        if (!g.contains(start) || !g.contains(goal)) {
             throw std::runtime_error("error: start or goal node not exist");
         }
+        if (!g.connected(start, goal)) {
+            throw std::runtime_error("error: path not exist");
+        }
 
         std::stack<vertex> stack;
         std::unordered_set<vertex, VertexHash> visited;
@@ -186,7 +204,7 @@ std::vector<vertex> dfsPathFinder::ShortestPath(const vertex& start, const verte
                 return path;
             }
 
-            for (const edge& neighbor : AdjacencyList.at(node)) {
+            for (const edge& neighbor : g.neighbors(node)) {
                 vertex destination = neighbor.getDestination();
                 if (visited.find(destination) == visited.end()) {
                     stack.push(destination);
@@ -211,25 +229,25 @@ bfsPathFinder::bfsPathFinder(const Graph& g, const vertex& A, const vertex& B)
     }
     }
 std::vector<vertex> bfsPathFinder::ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const{
-        const auto& AdjacencyList = g.getAdjacencyList();
-        if (AdjacencyList.find(start) == AdjacencyList.end() || AdjacencyList.find(goal) == AdjacencyList.end()) {
+        if (!g.contains(start) || !g.contains(goal)) {
             throw std::runtime_error("error: start or goal node not exist");
         }
+        if (!g.connected(start, goal)) {
+            throw std::runtime_error("error: path not exist");
+        }
         std::queue<vertex> que;
         std::unordered_set<vertex, VertexHash> visited;
         std::unordered_map<vertex, vertex, VertexHash> preds;
 
         que.push(start);
+        visited.insert(start);
 
+        // Marking vertices when they are queued keeps the pred of the first,
+        // shortest discovery.
         while (!que.empty()) {
             vertex node = que.front();
             que.pop();
 
-            if (visited.find(node) != visited.end()) {
-                continue;
-            }
-            visited.insert(node);
-
             if (node == goal) {
                 std::vector<vertex> path;
                 for (vertex v = goal; v != start; v = preds[v]) {
@@ -240,18 +258,95 @@ std::vector<vertex> bfsPathFinder::ShortestPath(const vertex& start, const verte
                 return path;
             }
 
-            for (const edge& neighbor : AdjacencyList.at(node)) {
+            for (const edge& neighbor : g.neighbors(node)) {
                 vertex destination = neighbor.getDestination();
-                if (visited.find(destination) == visited.end()) {
+                if (visited.insert(destination).second) {
                     que.push(destination);
                     preds[destination] = node;
-                    
                 }
             }
         }
         throw std::runtime_error("error: path not exist");
     }
 
+
+
+bidirectionalBfsPathFinder::bidirectionalBfsPathFinder(const Graph& g, const vertex& A, const vertex& B)
+        : PathFinder(g, A, B) {
+    try {
+        path = ShortestPath(A, B, g);
+    }
+    catch (std::runtime_error& a) {
+        std::cout << a.what();
+        throw;
+    }
+    }
+std::vector<vertex> bidirectionalBfsPathFinder::ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const{
+        if (!g.contains(start) || !g.contains(goal)) {
+            throw std::runtime_error("error: start or goal node not exist");
+        }
+        if (!g.connected(start, goal)) {
+            throw std::runtime_error("error: path not exist");
+        }
+        // The Graph only stores out-edges, so the backward side walks a reverse
+        // adjacency built for this query; CsrGraph keeps one for repeated queries.
+        std::unordered_map<vertex, std::vector<vertex>, VertexHash> reverse;
+        for (const auto& [u, edges] : g.adjacency()) {
+            for (const edge& e : edges) reverse[e.getDestination()].push_back(u);
+        }
+        static const std::vector<vertex> none;
+        // vertex -> (pred or succ, distance); only explored vertices get entries.
+        std::unordered_map<vertex, std::pair<vertex, size_t>, VertexHash> fwd, bwd;
+        fwd.emplace(start, std::make_pair(start, 0));
+        bwd.emplace(goal, std::make_pair(goal, 0));
+        std::vector<vertex> frontF{ start }, frontB{ goal }, next;
+        std::optional<vertex> meet;
+        if (start == goal) meet = start;
+
+        while (!meet && !frontF.empty() && !frontB.empty()) {
+            bool forward = frontF.size() <= frontB.size();
+            std::vector<vertex>& front = forward ? frontF : frontB;
+            auto& mine = forward ? fwd : bwd;
+            const auto& other = forward ? bwd : fwd;
+            size_t best = SIZE_MAX;
+            next.clear();
+            auto visit = [&](const vertex& u, const vertex& v, size_t d) {
+                if (!mine.emplace(v, std::make_pair(u, d)).second) return;
+                next.push_back(v);
+                auto hit = other.find(v);
+                if (hit != other.end() && d + hit->second.second < best) {
+                    best = d + hit->second.second;
+                    meet = v;
+                }
+            };
+            for (const vertex& u : front) {
+                size_t d = mine.at(u).second + 1;
+                if (forward) {
+                    for (const edge& e : g.neighbors(u)) visit(u, e.getDestination(), d);
+                }
+                else {
+                    auto in = reverse.find(u);
+                    for (const vertex& v : in != reverse.end() ? in->second : none) visit(u, v, d);
+                }
+            }
+            front.swap(next);
+        }
+        if (!meet) {
+            throw std::runtime_error("error: path not exist");
+        }
+        std::vector<vertex> path;
+        for (vertex v = *meet; v != start; v = fwd.at(v).first) {
+            path.push_back(v);
+        }
+        path.push_back(start);
+        std::reverse(path.begin(), path.end());
+        for (vertex v = *meet; v != goal; ) {
+            v = bwd.at(v).first;
+            path.push_back(v);
+        }
+        return path;
+    }
+
 
 
 
@@ -6,13 +6,21 @@
 #include <queue>
 #include <stack>
 #include <optional>
+#include <vector>
+#include <span>
+#include <string_view>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <barrier>
+#include <bit>
 
 class vertex final{
 public:
     vertex();
     vertex(const std::string& vername);
     bool operator == (const vertex& ver2) const;
-    std::string takeName() const;
+    const std::string& takeName() const;
 private:
     std::string verName;
 };
@@ -39,16 +47,158 @@ struct EdgeHash {
     std::size_t operator()(const edge& v) const;
 };
 
+class Graph;
+
+// Union-find over the vertices of a Graph, kept current as edges are added.
+// Edges are joined regardless of direction, so vertices in different
+// components have no path between them either way. Names are not copied:
+// ids views the vertices stored as the Graph's keys.
+class ComponentIndex final {
+public:
+    ComponentIndex() = default;
+    // The sets of other, viewing the names of owner, a copy of other's Graph.
+    ComponentIndex(const ComponentIndex& other, const Graph& owner);
+    ComponentIndex(ComponentIndex&&) = default;
+    ComponentIndex& operator=(ComponentIndex&&) = default;
+    ComponentIndex(const ComponentIndex&) = delete;
+    ComponentIndex& operator=(const ComponentIndex&) = delete;
+
+    // v must live as long as the index, as a Graph key does.
+    void add(const vertex& v);
+    // Both vertices must have been added.
+    void unite(const vertex& a, const vertex& b);
+    // False for unknown vertices.
+    bool connected(const vertex& a, const vertex& b) const;
+    size_t componentCount() const { return count; }
+private:
+    uint32_t find(uint32_t x) const;
+
+    std::unordered_map<std::string_view, uint32_t> ids; // views into the Graph's keys
+    std::vector<uint32_t> parent;
+    std::vector<uint8_t> rank;
+    size_t count = 0;
+};
+
+
 class Graph final {
 public:
     Graph();
+    // The component index views the keys, so a copy rebuilds it over its own.
+    Graph(const Graph& other);
+    Graph& operator=(const Graph& other);
+    Graph(Graph&&) = default;
+    Graph& operator=(Graph&&) = default;
     void addVertex(const vertex& newVer);
 
     void addEdge(const edge& Edge);
 
     std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> getAdjacencyList() const;
+
+    // Read-only views into the graph, nothing is copied.
+    bool contains(const vertex& v) const;
+    // Outgoing edges of v; an empty set for unknown vertices.
+    const std::unordered_set<edge, EdgeHash>& neighbors(const vertex& v) const;
+    const std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash>& adjacency() const;
+    size_t vertexCount() const;
+
+    bool connected(const vertex& a, const vertex& b) const { return components.connected(a, b); }
+    size_t componentCount() const { return components.componentCount(); }
 private:
     std::unordered_map<vertex, std::unordered_set<edge, EdgeHash>, VertexHash> graph;
+    ComponentIndex components;
+};
+
+
+// Read-only mapping of a whole file, unmapped on destruction.
+class MappedFile final {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return { data, bytes }; }
+private:
+    const char* data = nullptr;
+    size_t bytes = 0;
+};
+
+// "u-v" edge list, mapped and split at line ends into chunks parsed in parallel.
+// Names are views into the mapping, which lives as long as the parser.
+class EdgeListParser final {
+public:
+    using Pair = std::pair<std::string_view, std::string_view>;
+    // threads == 0 parses small files on one thread and large ones on every hardware thread.
+    explicit EdgeListParser(const std::string& filename, size_t threads = 0);
+    // Pairs of every chunk in file order; lines with an empty name are skipped.
+    const std::vector<std::vector<Pair>>& chunks() const { return parts; }
+private:
+    MappedFile file;
+    std::vector<std::vector<Pair>> parts;
+};
+
+// Snapshot file: header, name offsets (uint64, n + 1), name bytes padded to 8,
+// then offsets, targets, inOffsets, inTargets and component labels as uint32.
+struct GraphSnapshotHeader {
+    static constexpr uint32_t MAGIC = 0x48505247; // "GRPH"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint64_t vertexCount = 0;
+    uint64_t edgeCount = 0;
+    uint64_t nameBytes = 0;
+    uint64_t componentCount = 0;
+};
+
+
+// Frozen copy of a Graph: names interned to dense ids once, then neighbors of
+// vertex i are targets[offsets[i], offsets[i + 1]), sorted. The reverse arrays
+// hold in-neighbors the same way, for bottom-up traversal.
+class CsrGraph final {
+public:
+    // threads == 0 labels components on one thread for small graphs and on
+    // every hardware thread for large ones.
+    explicit CsrGraph(const Graph& g, size_t threads = 0);
+    CsrGraph(CsrGraph&&) = default;
+    CsrGraph& operator=(CsrGraph&&) = default;
+    // ids holds views into names, so a copy would point into the original.
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph& operator=(const CsrGraph&) = delete;
+
+    // Same graph as CsrGraph(readFromUnweightedFile(filename).getGrph()), built
+    // straight from the parsed chunks; duplicate edges are dropped silently.
+    static CsrGraph fromEdgeList(const std::string& filename, size_t threads = 0);
+    static CsrGraph loadSnapshot(const std::string& filename);
+    void saveSnapshot(const std::string& filename) const;
+
+    size_t vertexCount() const { return names.size(); }
+    size_t edgeCount() const { return targets.size(); }
+    std::optional<uint32_t> id(const vertex& v) const;
+    const vertex& getVertex(uint32_t id) const { return names[id]; }
+    std::span<const uint32_t> neighbors(uint32_t v) const {
+        return { targets.data() + offsets[v], targets.data() + offsets[v + 1] };
+    }
+    std::span<const uint32_t> inNeighbors(uint32_t v) const {
+        return { inTargets.data() + inOffsets[v], inTargets.data() + inOffsets[v + 1] };
+    }
+    // Weakly connected component of v, named by its smallest vertex id.
+    uint32_t component(uint32_t v) const { return componentOf[v]; }
+    bool connected(uint32_t a, uint32_t b) const { return componentOf[a] == componentOf[b]; }
+    size_t componentCount() const { return components; }
+
+private:
+    std::vector<vertex> names;
+    std::unordered_map<std::string_view, uint32_t> ids; // views into names
+    std::vector<uint32_t> offsets, targets;
+    std::vector<uint32_t> inOffsets, inTargets;
+    std::vector<uint32_t> componentOf;
+    size_t components = 0;
+
+    CsrGraph() = default;
+    void indexNames();
+    void buildReverse();
+    void labelComponents(size_t threads);
 };
 
 
@@ -70,6 +220,7 @@ public:
     virtual ~PathFinder() = default;
 
 protected:
+    PathFinder() = default;
     virtual std::vector<vertex> ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const = 0;
 
 
@@ -82,15 +233,76 @@ protected:
 class dfsPathFinder final : public PathFinder {
 public:
     dfsPathFinder(const Graph& g, const vertex& A, const vertex& B);
+    dfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B);
 private:
     std::vector<vertex> ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const override;
+    std::vector<uint32_t> ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const;
 };
 
 
 class bfsPathFinder final : public PathFinder {
 public:
     bfsPathFinder(const Graph& g, const vertex& A, const vertex& B);
+    bfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B);
 
 private:
     std::vector<vertex> ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const override;
+    std::vector<uint32_t> ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const;
+};
+
+
+// Bit-parallel multi-source BFS (MS-BFS): each vertex carries one bit per source
+// in the batch, so one sweep over a vertex's neighbors advances every source that
+// reached it at once. Batches of up to 256 sources share a traversal.
+class MultiSourceBfs final {
+public:
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+    static constexpr size_t MAX_BATCH = 256;
+
+    explicit MultiSourceBfs(const CsrGraph& g);
+
+    // Row-major sources x targets matrix of hop counts, UNREACHED where there is no path.
+    std::vector<uint32_t> distances(const std::vector<uint32_t>& sources, const std::vector<uint32_t>& targets) const;
+    // A shortest path per (start, goal) query, empty when there is none or a vertex is
+    // unknown. Batches of 64 starts, with a parent per vertex and start: 256 bytes per vertex.
+    std::vector<std::vector<vertex>> paths(const std::vector<std::pair<vertex, vertex>>& queries) const;
+
+private:
+    template<class Discover, class Done>
+    void run(const uint32_t* sources, size_t count, Discover discover, Done done) const;
+
+    const CsrGraph& graph;
+};
+
+// Point-to-point BFS from both ends: the side with the smaller frontier expands a
+// whole level at a time, and the search stops after the level in which the two
+// sides first meet, keeping the meeting vertex with the shortest total. The
+// backward side walks in-neighbors: a CsrGraph has them, for a Graph a reverse
+// adjacency is built per query.
+class bidirectionalBfsPathFinder final : public PathFinder {
+public:
+    bidirectionalBfsPathFinder(const Graph& g, const vertex& A, const vertex& B);
+    bidirectionalBfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B);
+
+private:
+    std::vector<vertex> ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const override;
+    std::vector<uint32_t> ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const;
+};
+
+// Level-synchronous BFS across a team of threads: each level's frontier is split
+// into chunks, vertices are claimed through an atomic visited bitmap and collected
+// in per-thread buffers that are joined at the level barrier. The Graph overload
+// is a convenience for one query: it rejects unknown or disconnected endpoints and
+// then freezes the Graph into a CsrGraph. Repeated queries should build the
+// CsrGraph once and use its overload.
+class parallelBfsPathFinder final : public PathFinder {
+public:
+    parallelBfsPathFinder(const Graph& g, const vertex& A, const vertex& B, size_t threads = std::thread::hardware_concurrency());
+    parallelBfsPathFinder(const CsrGraph& g, const vertex& A, const vertex& B, size_t threads = std::thread::hardware_concurrency());
+
+private:
+    std::vector<vertex> ShortestPath(const vertex& start, const vertex& goal, const Graph& g) const override;
+    std::vector<uint32_t> ShortestPath(uint32_t start, uint32_t goal, const CsrGraph& g) const;
+
+    size_t threadCount;
 };
@@ -0,0 +1,313 @@
+#include "graph.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    bytes = static_cast<size_t>(size.QuadPart);
+    HANDLE mapping = bytes ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (mapping) {
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+    }
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    bytes = static_cast<size_t>(st.st_size);
+    if (bytes) {
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        data = p == MAP_FAILED ? nullptr : static_cast<const char*>(p);
+    }
+    close(fd);
+#endif
+    if (bytes && !data) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), bytes);
+#endif
+}
+
+
+namespace {
+    const size_t PARALLEL_BYTES = 8 << 20;
+
+    size_t workerCount(size_t threads, size_t bytes) {
+        if (threads) return threads;
+        return bytes < PARALLEL_BYTES ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Runs body(0) .. body(count - 1), each on its own thread.
+    template<class Body>
+    void runTeam(size_t count, Body body) {
+        std::vector<std::thread> team;
+        for (size_t i = 1; i < count; ++i) team.emplace_back(body, i);
+        body(0);
+        for (auto& t : team) t.join();
+    }
+
+    // Same rules as getline(ss, u, '-') && getline(ss, v) in text mode: a line
+    // needs a '-' with something after it, and u ends at the first '-'.
+    bool parseLines(std::string_view text, std::vector<EdgeListParser::Pair>& out) {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = std::min(text.find('\n', pos), text.size());
+            std::string_view line = text.substr(pos, end - pos);
+            pos = end + 1;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            size_t dash = line.find('-');
+            if (dash == std::string_view::npos || dash + 1 == line.size()) {
+                return false;
+            }
+            if (dash == 0) continue;
+            out.emplace_back(line.substr(0, dash), line.substr(dash + 1));
+        }
+        return true;
+    }
+}
+
+EdgeListParser::EdgeListParser(const std::string& filename, size_t threads) : file(filename) {
+    std::string_view text = file.view();
+    const size_t count = std::max<size_t>(1, std::min(workerCount(threads, text.size()), text.size()));
+    // Cuts land just past a newline, so no line is split between chunks.
+    std::vector<size_t> cuts(count + 1, text.size());
+    cuts[0] = 0;
+    for (size_t i = 1; i < count; ++i) {
+        size_t p = text.find('\n', text.size() / count * i - 1);
+        cuts[i] = std::max(cuts[i - 1], p == std::string_view::npos ? text.size() : p + 1);
+    }
+
+    parts.resize(count);
+    std::vector<char> ok(count, 1);
+    runTeam(count, [&](size_t i) {
+        ok[i] = parseLines(text.substr(cuts[i], cuts[i + 1] - cuts[i]), parts[i]);
+    });
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        throw std::runtime_error("warning: invalid format: " + filename);
+    }
+}
+
+
+CsrGraph CsrGraph::fromEdgeList(const std::string& filename, size_t threads) {
+    EdgeListParser parser(filename, threads);
+    const auto& chunks = parser.chunks();
+    const size_t workers = chunks.size();
+    CsrGraph g;
+
+    // Names: sorted and unique per chunk, then merged.
+    std::vector<std::vector<std::string_view>> local(workers);
+    runTeam(workers, [&](size_t i) {
+        auto& seen = local[i];
+        seen.reserve(chunks[i].size() * 2);
+        for (const auto& [u, v] : chunks[i]) {
+            seen.push_back(u);
+            seen.push_back(v);
+        }
+        std::sort(seen.begin(), seen.end());
+        seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+    });
+    std::vector<std::string_view> all;
+    for (auto& seen : local) {
+        all.insert(all.end(), seen.begin(), seen.end());
+        std::vector<std::string_view>().swap(seen);
+    }
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    g.names.reserve(all.size());
+    for (std::string_view name : all) {
+        g.names.emplace_back(std::string(name));
+    }
+    g.indexNames();
+    const size_t n = g.names.size();
+
+    // Both directions of every line go in, counted and placed with atomics;
+    // a self-loop goes in once.
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> pairs(workers);
+    std::vector<std::atomic<uint32_t>> cursor(n);
+    for (auto& c : cursor) c.store(0, std::memory_order_relaxed);
+    std::atomic<uint64_t> total{ 0 };
+    runTeam(workers, [&](size_t i) {
+        pairs[i].reserve(chunks[i].size());
+        uint64_t added = 0;
+        for (const auto& [u, v] : chunks[i]) {
+            uint32_t a = g.ids.find(u)->second;
+            uint32_t b = g.ids.find(v)->second;
+            pairs[i].emplace_back(a, b);
+            cursor[a].fetch_add(1, std::memory_order_relaxed);
+            ++added;
+            if (a != b) {
+                cursor[b].fetch_add(1, std::memory_order_relaxed);
+                ++added;
+            }
+        }
+        total.fetch_add(added, std::memory_order_relaxed);
+    });
+    if (total.load() >= UINT32_MAX) {
+        throw std::runtime_error("error: too many edges in " + filename);
+    }
+
+    std::vector<uint32_t> offsets(n + 1, 0);
+    for (size_t v = 0; v < n; ++v) {
+        offsets[v + 1] = offsets[v] + cursor[v].load(std::memory_order_relaxed);
+        cursor[v].store(offsets[v], std::memory_order_relaxed);
+    }
+    std::vector<uint32_t> targets(offsets.back());
+    runTeam(workers, [&](size_t i) {
+        for (auto [a, b] : pairs[i]) {
+            targets[cursor[a].fetch_add(1, std::memory_order_relaxed)] = b;
+            if (a != b) targets[cursor[b].fetch_add(1, std::memory_order_relaxed)] = a;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(pairs[i]);
+    });
+
+    // Sort and dedupe every list in place, then close the gaps.
+    const size_t CHUNK = 4096;
+    std::vector<uint32_t> degree(n);
+    std::atomic<size_t> nextChunk{ 0 };
+    runTeam(workers, [&](size_t) {
+        for (size_t begin = nextChunk.fetch_add(CHUNK); begin < n; begin = nextChunk.fetch_add(CHUNK)) {
+            for (size_t v = begin; v < std::min(begin + CHUNK, n); ++v) {
+                uint32_t* first = targets.data() + offsets[v];
+                uint32_t* last = targets.data() + offsets[v + 1];
+                std::sort(first, last);
+                degree[v] = static_cast<uint32_t>(std::unique(first, last) - first);
+            }
+        }
+    });
+    g.offsets.assign(n + 1, 0);
+    for (size_t v = 0; v < n; ++v) {
+        g.offsets[v + 1] = g.offsets[v] + degree[v];
+        std::copy_n(targets.data() + offsets[v], degree[v], targets.data() + g.offsets[v]);
+    }
+    targets.resize(g.offsets.back());
+    targets.shrink_to_fit();
+    g.targets = std::move(targets);
+
+    g.buildReverse();
+    g.labelComponents(threads);
+    return g;
+}
+
+
+namespace {
+    template<class T>
+    void writeArray(std::ofstream& out, const std::vector<T>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template<class T>
+    bool sortedOffsets(const std::vector<T>& offsets, uint64_t last) {
+        return offsets.front() == 0 && offsets.back() == last && std::is_sorted(offsets.begin(), offsets.end());
+    }
+}
+
+void CsrGraph::saveSnapshot(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("error: dont open " + filename);
+    }
+    std::vector<uint64_t> nameOffsets(names.size() + 1, 0);
+    for (size_t i = 0; i < names.size(); ++i) {
+        nameOffsets[i + 1] = nameOffsets[i] + names[i].takeName().size();
+    }
+    GraphSnapshotHeader header;
+    header.vertexCount = names.size();
+    header.edgeCount = targets.size();
+    header.nameBytes = nameOffsets.back();
+    header.componentCount = components;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(out, nameOffsets);
+    for (const vertex& v : names) {
+        out.write(v.takeName().data(), v.takeName().size());
+    }
+    const char padding[8] = {};
+    out.write(padding, (8 - header.nameBytes % 8) % 8);
+    writeArray(out, offsets);
+    writeArray(out, targets);
+    writeArray(out, inOffsets);
+    writeArray(out, inTargets);
+    writeArray(out, componentOf);
+    if (!out) {
+        throw std::runtime_error("error: cant write " + filename);
+    }
+}
+
+CsrGraph CsrGraph::loadSnapshot(const std::string& filename) {
+    MappedFile file(filename);
+    std::string_view data = file.view();
+    auto bad = [&filename]() { return std::runtime_error("error: bad graph snapshot " + filename); };
+
+    GraphSnapshotHeader header;
+    if (data.size() < sizeof(header)) throw bad();
+    std::memcpy(&header, data.data(), sizeof(header));
+    const uint64_t n = header.vertexCount;
+    const uint64_t m = header.edgeCount;
+    if (header.magic != GraphSnapshotHeader::MAGIC || header.version != GraphSnapshotHeader::VERSION
+        || n >= UINT32_MAX || m >= UINT32_MAX || header.nameBytes > data.size()) {
+        throw bad();
+    }
+    const uint64_t namePadded = (header.nameBytes + 7) / 8 * 8;
+    if (data.size() != sizeof(header) + 8 * (n + 1) + namePadded + 4 * (3 * n + 2 * m + 2)) {
+        throw bad();
+    }
+
+    size_t pos = sizeof(header);
+    auto read = [&](auto& values, size_t count) {
+        values.resize(count);
+        std::memcpy(values.data(), data.data() + pos, count * sizeof(values[0]));
+        pos += count * sizeof(values[0]);
+    };
+    CsrGraph g;
+    std::vector<uint64_t> nameOffsets;
+    read(nameOffsets, n + 1);
+    if (!sortedOffsets(nameOffsets, header.nameBytes)) throw bad();
+    g.names.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        g.names.emplace_back(std::string(data.substr(pos + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i])));
+    }
+    pos += namePadded;
+    read(g.offsets, n + 1);
+    read(g.targets, m);
+    read(g.inOffsets, n + 1);
+    read(g.inTargets, m);
+    read(g.componentOf, n);
+    auto inRange = [n](uint32_t v) { return v < n; };
+    if (!sortedOffsets(g.offsets, m) || !sortedOffsets(g.inOffsets, m)
+        || !std::all_of(g.targets.begin(), g.targets.end(), inRange)
+        || !std::all_of(g.inTargets.begin(), g.inTargets.end(), inRange)
+        || !std::all_of(g.componentOf.begin(), g.componentOf.end(), inRange)) {
+        throw bad();
+    }
+    g.components = header.componentCount;
+    g.indexNames();
+    if (g.ids.size() != n) throw bad();
+    return g;
+}
@@ -0,0 +1,125 @@
+#include "graph.h"
+
+MultiSourceBfs::MultiSourceBfs(const CsrGraph& g) : graph(g) {}
+
+// discover(vertex, from, level, word, bits) is called for every vertex the sources
+// in bits reach first at that level; sources report themselves at level 0.
+// done() is checked after every level.
+template<class Discover, class Done>
+void MultiSourceBfs::run(const uint32_t* sources, size_t count, Discover discover, Done done) const {
+    const size_t n = graph.vertexCount();
+    const size_t words = (count + 63) / 64;
+    std::vector<uint64_t> seen(n * words, 0), visit(n * words, 0), next(n * words, 0);
+    std::vector<uint32_t> active, nextActive;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t s = sources[i];
+        uint64_t* vs = &visit[s * words];
+        if (std::all_of(vs, vs + words, [](uint64_t w) { return w == 0; })) active.push_back(s);
+        vs[i >> 6] |= uint64_t(1) << (i & 63);
+        seen[s * words + (i >> 6)] |= uint64_t(1) << (i & 63);
+    }
+    for (uint32_t s : active) {
+        for (size_t w = 0; w < words; ++w) {
+            if (visit[s * words + w]) discover(s, s, 0u, w, visit[s * words + w]);
+        }
+    }
+
+    for (uint32_t level = 1; !active.empty() && !done(); ++level) {
+        nextActive.clear();
+        for (uint32_t v : active) {
+            const uint64_t* vv = &visit[v * words];
+            for (uint32_t u : graph.neighbors(v)) {
+                uint64_t* su = &seen[u * words];
+                uint64_t* nu = &next[u * words];
+                bool idle = true, found = false;
+                for (size_t w = 0; w < words; ++w) {
+                    idle &= nu[w] == 0;
+                    uint64_t d = vv[w] & ~su[w];
+                    if (d) {
+                        nu[w] |= d;
+                        su[w] |= d;
+                        found = true;
+                        discover(u, v, level, w, d);
+                    }
+                }
+                if (found && idle) nextActive.push_back(u);
+            }
+        }
+        for (uint32_t v : active) std::fill_n(&visit[v * words], words, 0);
+        visit.swap(next);
+        active.swap(nextActive);
+    }
+}
+
+std::vector<uint32_t> MultiSourceBfs::distances(const std::vector<uint32_t>& sources, const std::vector<uint32_t>& targets) const {
+    const size_t cols = targets.size();
+    std::vector<uint32_t> res(sources.size() * cols, UNREACHED);
+    // vertex -> its columns, as a CSR of its own
+    std::vector<uint32_t> colOffsets(graph.vertexCount() + 1, 0), colIds(cols);
+    for (uint32_t t : targets) ++colOffsets[t + 1];
+    for (size_t v = 0; v < graph.vertexCount(); ++v) colOffsets[v + 1] += colOffsets[v];
+    std::vector<uint32_t> fill(colOffsets.begin(), colOffsets.end() - 1);
+    for (uint32_t j = 0; j < cols; ++j) colIds[fill[targets[j]]++] = j;
+
+    for (size_t base = 0; base < sources.size(); base += MAX_BATCH) {
+        const size_t count = std::min(MAX_BATCH, sources.size() - base);
+        size_t remaining = count * cols;
+        run(sources.data() + base, count,
+            [&](uint32_t u, uint32_t, uint32_t level, size_t w, uint64_t bits) {
+                if (colOffsets[u] == colOffsets[u + 1]) return;
+                for (; bits; bits &= bits - 1) {
+                    size_t row = base + w * 64 + std::countr_zero(bits);
+                    for (uint32_t k = colOffsets[u]; k < colOffsets[u + 1]; ++k) {
+                        res[row * cols + colIds[k]] = level;
+                        --remaining;
+                    }
+                }
+            },
+            [&remaining]() { return remaining == 0; });
+    }
+    return res;
+}
+
+std::vector<std::vector<vertex>> MultiSourceBfs::paths(const std::vector<std::pair<vertex, vertex>>& queries) const {
+    const size_t BATCH = 64;
+    const uint32_t NONE = UINT32_MAX;
+    std::vector<std::vector<vertex>> res(queries.size());
+
+    // Distinct starts, each with the queries that use it.
+    std::vector<uint32_t> starts;
+    std::unordered_map<uint32_t, std::vector<size_t>> byStart;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        auto s = graph.id(queries[q].first);
+        if (!s || !graph.id(queries[q].second)) continue;
+        auto [it, added] = byStart.try_emplace(*s);
+        if (added) starts.push_back(*s);
+        it->second.push_back(q);
+    }
+
+    std::vector<uint32_t> parent;
+    for (size_t base = 0; base < starts.size(); base += BATCH) {
+        const size_t count = std::min(BATCH, starts.size() - base);
+        parent.assign(graph.vertexCount() * BATCH, NONE);
+        run(starts.data() + base, count,
+            [&](uint32_t u, uint32_t from, uint32_t, size_t, uint64_t bits) {
+                for (; bits; bits &= bits - 1) parent[u * BATCH + std::countr_zero(bits)] = from;
+            },
+            []() { return false; });
+
+        for (size_t slot = 0; slot < count; ++slot) {
+            uint32_t start = starts[base + slot];
+            for (size_t q : byStart[start]) {
+                uint32_t goal = *graph.id(queries[q].second);
+                if (parent[goal * BATCH + slot] == NONE) continue;
+                std::vector<vertex>& path = res[q];
+                for (uint32_t v = goal; v != start; v = parent[v * BATCH + slot]) {
+                    path.push_back(graph.getVertex(v));
+                }
+                path.push_back(graph.getVertex(start));
+                std::reverse(path.begin(), path.end());
+            }
+        }
+    }
+    return res;
+}
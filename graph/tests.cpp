@@ -133,3 +133,211 @@ TEST_F(GraphTest, SingleEdge) {
 
 
 
+
+TEST_F(GraphTest, CsrPaths) {
+    createGraphFile("test.txt", { "A-B", "B-C", "C-D", "D-E", "A-F", "F-E", "X-Y" });
+    readFromUnweightedFile File("test.txt");
+    CsrGraph csr(File.getGrph());
+
+    EXPECT_EQ(csr.vertexCount(), 8);
+    EXPECT_EQ(csr.edgeCount(), 14);
+    ASSERT_TRUE(csr.id(vertex("A")).has_value());
+    EXPECT_EQ(csr.getVertex(*csr.id(vertex("A"))), vertex("A"));
+    EXPECT_FALSE(csr.id(vertex("Q")).has_value());
+
+    vertex A("A");
+    vertex E("E");
+    bfsPathFinder bfs(csr, A, E);
+    std::vector<vertex> expected = { A, vertex("F"), E };
+    EXPECT_EQ(bfs.getPath(), expected);
+
+    dfsPathFinder dfs(csr, A, E);
+    EXPECT_EQ(dfs.getPath().front(), A);
+    EXPECT_EQ(dfs.getPath().back(), E);
+
+    EXPECT_THROW(bfsPathFinder f(csr, A, vertex("X")), std::runtime_error);
+    EXPECT_THROW(dfsPathFinder f(csr, A, vertex("Q")), std::runtime_error);
+}
+
+TEST_F(GraphTest, AdjacencyView) {
+    createGraphFile("test.txt", { "A-B", "A-C" });
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+
+    EXPECT_TRUE(Gr.contains(vertex("A")));
+    EXPECT_FALSE(Gr.contains(vertex("D")));
+    EXPECT_EQ(Gr.vertexCount(), 3);
+    EXPECT_EQ(Gr.neighbors(vertex("A")).size(), 2);
+    EXPECT_TRUE(Gr.neighbors(vertex("D")).empty());
+    EXPECT_EQ(&Gr.neighbors(vertex("A")), &Gr.adjacency().at(vertex("A")));
+}
+
+TEST_F(GraphTest, BfsShortestOnHubGraph) {
+    // Two hubs joined through a chain of 3 vertices, both with many leaves, and a
+    // long detour around. The middle levels are large enough for bottom-up steps.
+    std::vector<std::string> edges = { "H1-M1", "M1-M2", "M2-M3", "M3-H2" };
+    for (int i = 0; i < 500; ++i) {
+        edges.push_back("H1-a" + std::to_string(i));
+        edges.push_back("H2-b" + std::to_string(i));
+        edges.push_back("a" + std::to_string(i) + "-c" + std::to_string(i));
+    }
+    for (int i = 0; i < 10; ++i) {
+        edges.push_back("L" + std::to_string(i) + "-L" + std::to_string(i + 1));
+    }
+    edges.push_back("c0-L0");
+    edges.push_back("L10-b7");
+    createGraphFile("test.txt", edges);
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+    CsrGraph csr(Gr);
+
+    vertex from("c3");
+    vertex to("b7");
+    bfsPathFinder onCsr(csr, from, to);
+    bfsPathFinder onGraph(Gr, from, to);
+    // c3 a3 H1 M1 M2 M3 H2 b7
+    EXPECT_EQ(onCsr.getPath().size(), 8);
+    EXPECT_EQ(onGraph.getPath().size(), 8);
+    for (size_t i = 0; i + 1 < onCsr.getPath().size(); ++i) {
+        EXPECT_TRUE(Gr.neighbors(onCsr.getPath()[i]).contains(edge(onCsr.getPath()[i], onCsr.getPath()[i + 1])));
+    }
+}
+
+TEST_F(GraphTest, ParallelBfs) {
+    // 40x40 grid: the corner-to-corner distance is 78 edges.
+    std::vector<std::string> edges;
+    auto name = [](int r, int c) { return std::to_string(r) + "_" + std::to_string(c); };
+    for (int r = 0; r < 40; ++r) {
+        for (int c = 0; c < 40; ++c) {
+            if (c + 1 < 40) edges.push_back(name(r, c) + "-" + name(r, c + 1));
+            if (r + 1 < 40) edges.push_back(name(r, c) + "-" + name(r + 1, c));
+        }
+    }
+    edges.push_back("X-Y");
+    createGraphFile("test.txt", edges);
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+    CsrGraph csr(Gr);
+
+    vertex A("0_0");
+    vertex B("39_39");
+    parallelBfsPathFinder finder(csr, A, B, 4);
+    EXPECT_EQ(finder.getPath().size(), 79);
+    EXPECT_EQ(finder.getPath().front(), A);
+    EXPECT_EQ(finder.getPath().back(), B);
+    EXPECT_EQ(parallelBfsPathFinder(Gr, A, B, 3).getPath().size(), 79);
+    EXPECT_EQ(parallelBfsPathFinder(csr, A, A, 2).getPath().size(), 1);
+    EXPECT_THROW(parallelBfsPathFinder f(csr, A, vertex("X"), 4), std::runtime_error);
+    EXPECT_THROW(parallelBfsPathFinder f(Gr, A, vertex("X"), 4), std::runtime_error);
+    EXPECT_THROW(parallelBfsPathFinder f(Gr, A, vertex("Z"), 4), std::runtime_error);
+}
+
+TEST_F(GraphTest, BidirectionalBfs) {
+    createGraphFile("test.txt", { "A-B", "B-C", "C-D", "D-E", "E-F", "A-G", "G-H", "H-F", "X-Y" });
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+    CsrGraph csr(Gr);
+
+    vertex A("A");
+    vertex F("F");
+    std::vector<vertex> expected = { A, vertex("G"), vertex("H"), F };
+    EXPECT_EQ(bidirectionalBfsPathFinder(Gr, A, F).getPath(), expected);
+    EXPECT_EQ(bidirectionalBfsPathFinder(csr, A, F).getPath(), expected);
+    EXPECT_EQ(bidirectionalBfsPathFinder(Gr, A, A).getPath().size(), 1);
+    EXPECT_THROW(bidirectionalBfsPathFinder f(Gr, A, vertex("X")), std::runtime_error);
+    EXPECT_THROW(bidirectionalBfsPathFinder f(csr, A, vertex("Y")), std::runtime_error);
+
+    // One-way edges: S->M<-T must not be joined at M, the only path is S->X->Y->T.
+    Graph directed;
+    for (auto [u, v] : { std::pair{ "S", "M" }, { "T", "M" }, { "S", "X" }, { "X", "Y" }, { "Y", "T" } }) {
+        directed.addEdge(edge(vertex(u), vertex(v)));
+    }
+    std::vector<vertex> oneWay = { vertex("S"), vertex("X"), vertex("Y"), vertex("T") };
+    EXPECT_EQ(bidirectionalBfsPathFinder(directed, vertex("S"), vertex("T")).getPath(), oneWay);
+    EXPECT_EQ(bidirectionalBfsPathFinder(CsrGraph(directed), vertex("S"), vertex("T")).getPath(), oneWay);
+    EXPECT_THROW(bidirectionalBfsPathFinder f(directed, vertex("T"), vertex("S")), std::runtime_error);
+}
+
+TEST_F(GraphTest, MultiSourceBfs) {
+    createGraphFile("test.txt", { "A-B", "B-C", "C-D", "A-E", "E-D", "X-Y" });
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+    CsrGraph csr(Gr);
+    MultiSourceBfs ms(csr);
+
+    std::vector<uint32_t> sources = { *csr.id(vertex("A")), *csr.id(vertex("C")) };
+    std::vector<uint32_t> targets = { *csr.id(vertex("D")), *csr.id(vertex("A")), *csr.id(vertex("Y")) };
+    std::vector<uint32_t> expected = { 2, 0, MultiSourceBfs::UNREACHED, 1, 2, MultiSourceBfs::UNREACHED };
+    EXPECT_EQ(ms.distances(sources, targets), expected);
+
+    auto paths = ms.paths({ { vertex("A"), vertex("D") }, { vertex("C"), vertex("A") }, { vertex("A"), vertex("Y") } });
+    std::vector<vertex> toD = { vertex("A"), vertex("E"), vertex("D") };
+    EXPECT_EQ(paths[0], toD);
+    EXPECT_EQ(paths[1].size(), 3);
+    EXPECT_TRUE(paths[2].empty());
+}
+
+TEST_F(GraphTest, ComponentIndex) {
+    createGraphFile("test.txt", { "A-B", "B-C", "X-Y", "Z-Z" });
+    readFromUnweightedFile File("test.txt");
+    Graph Gr = File.getGrph();
+    EXPECT_EQ(Gr.componentCount(), 3);
+    EXPECT_TRUE(Gr.connected(vertex("A"), vertex("C")));
+    EXPECT_FALSE(Gr.connected(vertex("A"), vertex("X")));
+    EXPECT_FALSE(Gr.connected(vertex("A"), vertex("nope")));
+    EXPECT_THROW(bfsPathFinder f(Gr, vertex("A"), vertex("Y")), std::runtime_error);
+    EXPECT_THROW(dfsPathFinder f(Gr, vertex("A"), vertex("Y")), std::runtime_error);
+
+    Gr.addEdge(edge(vertex("C"), vertex("X")));
+    EXPECT_EQ(Gr.componentCount(), 2);
+    EXPECT_TRUE(Gr.connected(vertex("Y"), vertex("A")));
+    EXPECT_EQ(bfsPathFinder(Gr, vertex("A"), vertex("Y")).getPath().size(), 5);
+
+    CsrGraph csr(Gr, 4);
+    EXPECT_EQ(csr.componentCount(), 2);
+    EXPECT_TRUE(csr.connected(*csr.id(vertex("A")), *csr.id(vertex("Y"))));
+    EXPECT_FALSE(csr.connected(*csr.id(vertex("A")), *csr.id(vertex("Z"))));
+    EXPECT_THROW(bfsPathFinder f(csr, vertex("A"), vertex("Z")), std::runtime_error);
+
+    // the index views the graph's own names, so copies must not share them
+    Graph copy;
+    {
+        Graph tmp = Gr;
+        copy = tmp;
+    }
+    copy.addEdge(edge(vertex("Z"), vertex("A")));
+    EXPECT_EQ(copy.componentCount(), 1);
+    EXPECT_TRUE(copy.connected(vertex("Z"), vertex("Y")));
+    EXPECT_EQ(Gr.componentCount(), 2);
+    EXPECT_FALSE(Gr.connected(vertex("Z"), vertex("Y")));
+}
+
+TEST_F(GraphTest, EdgeListLoaderAndSnapshot) {
+    createGraphFile("test.txt", { "A-B", "B-C", "B-A", "X-Y", "Z-Z", "C-D\r" });
+    readFromUnweightedFile File("test.txt");
+    CsrGraph fromGraph(File.getGrph());
+    CsrGraph loaded = CsrGraph::fromEdgeList("test.txt", 3);
+
+    ASSERT_EQ(loaded.vertexCount(), fromGraph.vertexCount());
+    EXPECT_EQ(loaded.edgeCount(), fromGraph.edgeCount());
+    EXPECT_EQ(loaded.componentCount(), 3);
+    for (uint32_t v = 0; v < loaded.vertexCount(); ++v) {
+        EXPECT_EQ(loaded.getVertex(v), fromGraph.getVertex(v));
+        auto a = loaded.neighbors(v);
+        auto b = fromGraph.neighbors(v);
+        EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+    }
+
+    loaded.saveSnapshot("graph.snap");
+    CsrGraph snap = CsrGraph::loadSnapshot("graph.snap");
+    EXPECT_EQ(snap.edgeCount(), loaded.edgeCount());
+    EXPECT_EQ(bfsPathFinder(snap, vertex("A"), vertex("D")).getPath().size(), 4);
+    EXPECT_THROW(bfsPathFinder f(snap, vertex("A"), vertex("Y")), std::runtime_error);
+
+    createGraphFile("bad.snap", { "not a snapshot" });
+    EXPECT_THROW(CsrGraph::loadSnapshot("bad.snap"), std::runtime_error);
+    createGraphFile("test.txt", { "A-B", "AB" });
+    EXPECT_THROW(CsrGraph::fromEdgeList("test.txt"), std::runtime_error);
+    std::remove("graph.snap");
+    std::remove("bad.snap");
+}